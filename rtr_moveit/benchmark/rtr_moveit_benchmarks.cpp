@@ -0,0 +1,369 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Benchmarks for roadmap search and planning scene voxelization on synthetic data.
+ *       Search benchmarks use random roadmaps with 1k to 1M states and 6 or 7 joints, queries are perturbed roadmap
+ *       states like start and goal states of planning requests. Voxelization benchmarks use random planning scenes
+ *       with different numbers of collision objects and voxel resolutions.
+ *       Each benchmark reports the query throughput and the 50th, 90th and 99th percentile of the query latency.
+ *       The voxelization benchmarks create a ros::NodeHandle for the OccupancyHandler and need a running roscore.
+ */
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Google Benchmark
+#include <benchmark/benchmark.h>
+
+// ROS
+#include <ros/ros.h>
+
+// MoveIt!
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit_msgs/CollisionObject.h>
+#include <srdfdom/model.h>
+#include <urdf_model/model.h>
+
+// rtr_moveit
+#include <rtr_moveit/occupancy_handler.h>
+#include <rtr_moveit/roadmap_search.h>
+#include <rtr_moveit/rtr_datatypes.h>
+
+namespace
+{
+const std::size_t NUM_QUERIES = 256;
+const float ALLOWED_JOINT_DISTANCE = 0.5;
+const float ALLOWED_POSITION_DISTANCE = 0.1;
+const float ALLOWED_ORIENTATION_DISTANCE = 0.3;
+const std::size_t MAX_RESULTS = 5;
+
+/** Synthetic roadmap with random configs and tool poses, and queries close to roadmap states */
+struct Roadmap
+{
+  std::shared_ptr<std::vector<rtr::Config>> configs;
+  std::vector<rtr::ToolPose> poses;
+  std::vector<rtr::Config> config_queries;
+  std::vector<rtr::ToolPose> pose_queries;
+};
+
+/** Returns the roadmap for a number of states and joints, roadmaps are only created once per benchmark run */
+const Roadmap& getRoadmap(std::size_t num_states, std::size_t num_joints)
+{
+  static std::map<std::pair<std::size_t, std::size_t>, Roadmap> roadmaps;
+  Roadmap& roadmap = roadmaps[std::make_pair(num_states, num_joints)];
+  if (roadmap.configs)
+    return roadmap;
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> joint_distribution(-M_PI, M_PI);
+  std::uniform_real_distribution<float> position_distribution(-0.5, 0.5);
+  std::uniform_real_distribution<float> noise(-0.05, 0.05);
+  roadmap.configs = std::make_shared<std::vector<rtr::Config>>(num_states, rtr::Config(num_joints));
+  roadmap.poses.resize(num_states);
+  for (std::size_t i = 0; i < num_states; ++i)
+  {
+    for (float& value : (*roadmap.configs)[i])
+      value = joint_distribution(rng);
+    for (std::size_t axis = 0; axis < 6; ++axis)
+      roadmap.poses[i][axis] = axis < 3 ? position_distribution(rng) : joint_distribution(rng);
+  }
+  std::uniform_int_distribution<std::size_t> state_distribution(0, num_states - 1);
+  for (std::size_t i = 0; i < NUM_QUERIES; ++i)
+  {
+    const std::size_t state = state_distribution(rng);
+    roadmap.config_queries.push_back((*roadmap.configs)[state]);
+    for (float& value : roadmap.config_queries.back())
+      value += noise(rng);
+    roadmap.pose_queries.push_back(roadmap.poses[state]);
+    for (float& value : roadmap.pose_queries.back())
+      value += noise(rng);
+  }
+  return roadmap;
+}
+
+/** Runs a query per benchmark iteration and reports throughput and latency percentiles
+ * @param state - The benchmark state
+ * @param items_per_query - The number of roadmap states or voxels that are processed by each query
+ * @param query - Function that runs the query with the given iteration number
+ */
+template <class Query>
+void runQueries(benchmark::State& state, std::size_t items_per_query, const Query& query)
+{
+  std::vector<double> latencies;
+  std::size_t iteration = 0;
+  for (auto _ : state)
+  {
+    auto start_time = std::chrono::steady_clock::now();
+    query(iteration++);
+    std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - start_time;
+    latencies.push_back(latency.count());
+  }
+  state.SetItemsProcessed(items_per_query * state.iterations());
+  if (latencies.empty())
+    return;
+  std::sort(latencies.begin(), latencies.end());
+  for (std::size_t percentile : { 50, 90, 99 })
+    state.counters["p" + std::to_string(percentile) + "_us"] =
+        latencies[std::min(latencies.size() - 1, latencies.size() * percentile / 100)];
+}
+
+/** Roadmap sizes and joint counts of the search benchmarks */
+void roadmapArguments(benchmark::internal::Benchmark* benchmark)
+{
+  benchmark->ArgNames({ "states", "joints" });
+  for (std::size_t num_joints : { 6, 7 })
+    for (std::size_t num_states : { 1000, 10000, 100000, 1000000 })
+      benchmark->Args({ long(num_states), long(num_joints) });
+  benchmark->Unit(benchmark::kMicrosecond);
+}
+
+// Linear search as used by the planning context before search indices
+void findClosestConfigs(benchmark::State& state)
+{
+  const Roadmap& roadmap = getRoadmap(state.range(0), state.range(1));
+  std::vector<std::size_t> ids;
+  std::vector<float> distances;
+  runQueries(state, roadmap.configs->size(), [&](std::size_t i) {
+    rtr_moveit::findClosestConfigs(roadmap.config_queries[i % NUM_QUERIES], *roadmap.configs, ids, distances,
+                                   MAX_RESULTS, ALLOWED_JOINT_DISTANCE);
+  });
+}
+BENCHMARK(findClosestConfigs)->Apply(roadmapArguments);
+
+void configStoreFindClosest(benchmark::State& state)
+{
+  const Roadmap& roadmap = getRoadmap(state.range(0), state.range(1));
+  rtr_moveit::ConfigStore config_store(*roadmap.configs);
+  std::vector<std::size_t> ids;
+  std::vector<float> distances;
+  runQueries(state, roadmap.configs->size(), [&](std::size_t i) {
+    config_store.findClosest(roadmap.config_queries[i % NUM_QUERIES], ids, distances, MAX_RESULTS,
+                             ALLOWED_JOINT_DISTANCE);
+  });
+}
+BENCHMARK(configStoreFindClosest)->Apply(roadmapArguments);
+
+void quantizedConfigStoreFindClosest(benchmark::State& state)
+{
+  const Roadmap& roadmap = getRoadmap(state.range(0), state.range(1));
+  rtr_moveit::QuantizedConfigStore config_store(roadmap.configs);
+  config_store.reserve(roadmap.configs->size());
+  for (std::size_t i = 0; i < roadmap.configs->size(); ++i)
+    config_store.append(i);
+  std::vector<std::size_t> ids;
+  std::vector<float> distances;
+  runQueries(state, roadmap.configs->size(), [&](std::size_t i) {
+    config_store.findClosest(roadmap.config_queries[i % NUM_QUERIES], ids, distances, MAX_RESULTS,
+                             ALLOWED_JOINT_DISTANCE);
+  });
+}
+BENCHMARK(quantizedConfigStoreFindClosest)->Apply(roadmapArguments);
+
+void configIndexFindClosest(benchmark::State& state)
+{
+  const Roadmap& roadmap = getRoadmap(state.range(0), state.range(1));
+  rtr_moveit::ConfigIndex config_index(roadmap.configs, state.range(2) != 0);
+  std::vector<std::size_t> ids;
+  std::vector<float> distances;
+  runQueries(state, roadmap.configs->size(), [&](std::size_t i) {
+    config_index.findClosest(roadmap.config_queries[i % NUM_QUERIES], ids, distances, MAX_RESULTS,
+                             ALLOWED_JOINT_DISTANCE);
+  });
+}
+BENCHMARK(configIndexFindClosest)->Apply([](benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({ "states", "joints", "quantized" });
+  for (long quantized : { 0, 1 })
+    for (std::size_t num_joints : { 6, 7 })
+      for (std::size_t num_states : { 1000, 10000, 100000, 1000000 })
+        benchmark->Args({ long(num_states), long(num_joints), quantized });
+  benchmark->Unit(benchmark::kMicrosecond);
+});
+
+// Linear position search
+void findClosestPositions(benchmark::State& state)
+{
+  const Roadmap& roadmap = getRoadmap(state.range(0), state.range(1));
+  std::vector<std::size_t> ids;
+  std::vector<float> distances;
+  runQueries(state, roadmap.poses.size(), [&](std::size_t i) {
+    rtr_moveit::findClosestPositions(roadmap.pose_queries[i % NUM_QUERIES], roadmap.poses, ids, distances,
+                                     MAX_RESULTS, ALLOWED_POSITION_DISTANCE);
+  });
+}
+BENCHMARK(findClosestPositions)->Apply(roadmapArguments);
+
+void poseIndexFindClosest(benchmark::State& state)
+{
+  const Roadmap& roadmap = getRoadmap(state.range(0), state.range(1));
+  rtr_moveit::PoseIndex pose_index(roadmap.poses);
+  std::vector<std::size_t> ids;
+  std::vector<float> distances;
+  runQueries(state, roadmap.poses.size(), [&](std::size_t i) {
+    pose_index.findClosest(roadmap.pose_queries[i % NUM_QUERIES], ids, distances, MAX_RESULTS,
+                           ALLOWED_POSITION_DISTANCE);
+  });
+}
+BENCHMARK(poseIndexFindClosest)->Apply(roadmapArguments);
+
+void poseIndexFindWithinTolerance(benchmark::State& state)
+{
+  const Roadmap& roadmap = getRoadmap(state.range(0), state.range(1));
+  rtr_moveit::PoseIndex pose_index(roadmap.poses);
+  std::vector<std::size_t> ids;
+  std::vector<float> distances;
+  runQueries(state, roadmap.poses.size(), [&](std::size_t i) {
+    pose_index.findWithinTolerance(roadmap.pose_queries[i % NUM_QUERIES], ids, distances, ALLOWED_POSITION_DISTANCE,
+                                   ALLOWED_ORIENTATION_DISTANCE);
+  });
+}
+BENCHMARK(poseIndexFindWithinTolerance)->Apply(roadmapArguments);
+
+/** Creates a planning scene with random boxes, spheres and cylinders inside of the unit cube */
+planning_scene::PlanningScenePtr createPlanningScene(std::size_t num_objects)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model(new urdf::ModelInterface());
+  srdf::ModelConstSharedPtr srdf_model(new srdf::Model());
+  moveit::core::RobotModelConstPtr robot_model(new moveit::core::RobotModel(urdf_model, srdf_model));
+  planning_scene::PlanningScenePtr scene(new planning_scene::PlanningScene(robot_model));
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> position_distribution(0.0, 1.0);
+  std::uniform_real_distribution<double> size_distribution(0.02, 0.2);
+  std::uniform_real_distribution<double> quaternion_distribution(-1.0, 1.0);
+  for (std::size_t i = 0; i < num_objects; ++i)
+  {
+    moveit_msgs::CollisionObject object;
+    object.id = "object_" + std::to_string(i);
+    object.header.frame_id = scene->getPlanningFrame();
+    object.operation = moveit_msgs::CollisionObject::ADD;
+    object.primitives.resize(1);
+    shape_msgs::SolidPrimitive& primitive = object.primitives[0];
+    switch (i % 3)
+    {
+      case 0:
+        primitive.type = shape_msgs::SolidPrimitive::BOX;
+        primitive.dimensions = { size_distribution(rng), size_distribution(rng), size_distribution(rng) };
+        break;
+      case 1:
+        primitive.type = shape_msgs::SolidPrimitive::SPHERE;
+        primitive.dimensions = { 0.5 * size_distribution(rng) };
+        break;
+      default:
+        primitive.type = shape_msgs::SolidPrimitive::CYLINDER;
+        primitive.dimensions = { size_distribution(rng), 0.5 * size_distribution(rng) };
+    }
+    object.primitive_poses.resize(1);
+    geometry_msgs::Pose& pose = object.primitive_poses[0];
+    pose.position.x = position_distribution(rng);
+    pose.position.y = position_distribution(rng);
+    pose.position.z = position_distribution(rng);
+    Eigen::Quaterniond orientation(quaternion_distribution(rng), quaternion_distribution(rng),
+                                   quaternion_distribution(rng), quaternion_distribution(rng));
+    orientation.normalize();
+    pose.orientation.w = orientation.w();
+    pose.orientation.x = orientation.x();
+    pose.orientation.y = orientation.y();
+    pose.orientation.z = orientation.z();
+    scene->processCollisionObjectMsg(object);
+  }
+  return scene;
+}
+
+// Planning scene voxelization with the occupancy cache disabled. ANALYTIC voxelization reuses the voxels of unchanged
+// objects, so it measures repeated queries of a static scene. COLLISION_CHECKS is run with different thread counts to
+// measure the speedup of the parallel collision checks.
+void fromPlanningScene(benchmark::State& state)
+{
+  const std::size_t num_objects = state.range(0);
+  const std::size_t resolution = state.range(1);
+  const auto method = static_cast<rtr_moveit::OccupancyHandler::VoxelizationMethod>(state.range(2));
+  const std::size_t num_threads = state.range(3);
+  planning_scene::PlanningScenePtr scene = createPlanningScene(num_objects);
+
+  rtr_moveit::RoadmapVolume volume;
+  volume.pose.header.frame_id = scene->getPlanningFrame();
+  volume.pose.pose.orientation.w = 1.0;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+  {
+    volume.dimension[axis] = 1.0;
+    volume.voxel_resolution[axis] = resolution;
+  }
+  ros::NodeHandle nh;
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+  occupancy_handler.setVolumeRegion(volume);
+  occupancy_handler.setVoxelizationMethod(method);
+  occupancy_handler.setVoxelizationThreads(num_threads);
+  occupancy_handler.setOccupancyCacheSize(0);
+
+  rtr_moveit::OccupancyData occupancy_data;
+  runQueries(state, resolution * resolution * resolution, [&](std::size_t) {
+    occupancy_data.voxels.clear();
+    occupancy_handler.fromPlanningScene(scene, occupancy_data);
+  });
+  state.counters["voxels"] = occupancy_data.voxels.size();
+}
+BENCHMARK(fromPlanningScene)->Apply([](benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({ "objects", "resolution", "method", "threads" });
+  for (long method : { rtr_moveit::OccupancyHandler::COLLISION_CHECKS, rtr_moveit::OccupancyHandler::ANALYTIC,
+                       rtr_moveit::OccupancyHandler::HIERARCHICAL })
+    for (long num_objects : { 1, 10, 100 })
+      for (long resolution : { 16, 32, 64 })
+      {
+        if (method != rtr_moveit::OccupancyHandler::COLLISION_CHECKS)
+          benchmark->Args({ num_objects, resolution, method, 1 });
+        else if (resolution <= 32)
+          for (long num_threads : { 1, 4, 16 })
+            benchmark->Args({ num_objects, resolution, method, num_threads });
+      }
+  benchmark->Unit(benchmark::kMillisecond);
+});
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "rtr_moveit_benchmarks", ros::init_options::AnonymousName);
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
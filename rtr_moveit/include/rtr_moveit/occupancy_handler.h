@@ -39,14 +39,31 @@
 #ifndef RTR_MOVEIT_OCCUPANCY_HANDLER_H
 #define RTR_MOVEIT_OCCUPANCY_HANDLER_H
 
+// C++
+#include <array>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
 // C++ synchronization
-#include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <mutex>
 
 // PCL
 #include <pcl/pcl_base.h>
 
+// TF
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+
+// Eigen
+#include <Eigen/Geometry>
+
 // MoveIt!
+#include <moveit/macros/class_forward.h>
 #include <moveit/planning_scene/planning_scene.h>
 
 // rtr_moveit
@@ -54,9 +71,23 @@
 
 namespace rtr_moveit
 {
+MOVEIT_CLASS_FORWARD(OccupancyHandler);
+
 class OccupancyHandler
 {
 public:
+  /* @brief World transform type of collision objects - Affine3d (kinetic) or Isometry3d (melodic) */
+  typedef decltype(std::declval<collision_detection::World::Object>().shape_poses_)::value_type WorldTransform;
+
+  /* @brief Methods for generating occupancy voxels from planning scenes */
+  enum VoxelizationMethod
+  {
+    COLLISION_CHECKS,  // check each voxel box for collisions with the planning scene
+    ANALYTIC,          // rasterize the collision objects directly into the voxel grid, only objects that changed
+                       // since the last query are rasterized again
+    HIERARCHICAL       // check octants of the volume region for collisions and only subdivide colliding octants
+  };
+
   /* @brief Constructor */
   OccupancyHandler(const ros::NodeHandle& nh);
 
@@ -66,11 +97,47 @@ public:
   void setVolumeRegion(const RoadmapVolume& roadmap_volume);
 
   /* @brief Set the point cloud topic for all pcl queries
+   *         The topic is subscribed persistently so that queries don't need to wait for new messages
    * @param  pcl_topic  - The new pcl topic
    */
   void setPointCloudTopic(const std::string& pcl_topic);
 
-  /* @brief Initializes occupancy_data with a new point cloud
+  /* @brief Set the maximum age of point clouds used by pcl queries
+   * @param  max_age  - The maximum age in seconds
+   */
+  void setPointCloudMaxAge(double max_age);
+
+  /* @brief Enable conversion of point clouds into voxels
+   *         Points are cropped to the volume region and each occupied voxel is only passed once
+   * @param  enabled  - If true, pcl queries return VOXELS instead of a POINT_CLOUD
+   */
+  void setPointCloudVoxelization(bool enabled);
+
+  /* @brief Set the method used for generating voxels from planning scenes
+   * @param  method  - The voxelization method
+   */
+  void setVoxelizationMethod(VoxelizationMethod method);
+
+  /* @brief Set the number of threads used for COLLISION_CHECKS voxelization
+   * @param  num_threads  - The number of threads, 0 uses all available cores
+   */
+  void setVoxelizationThreads(std::size_t num_threads);
+
+  /* @brief Set the number of planning scene query results that are cached for reuse
+   *         Results are identified by the collision objects, the volume region and the voxelization method.
+   *         Scenes with OctoMaps are never cached.
+   * @param  cache_size  - The number of cached results, 0 disables the cache
+   */
+  void setOccupancyCacheSize(std::size_t cache_size);
+
+  /* @brief Returns the number of planning scene queries that reused a cached result */
+  std::size_t getCacheHits();
+
+  /* @brief Returns the number of cacheable planning scene queries that were not found in the cache */
+  std::size_t getCacheMisses();
+
+  /* @brief Initializes occupancy_data with the latest point cloud, or its voxels if voxelization is enabled
+   *         Only waits for a new message if the latest point cloud exceeds the max age
    * @param  point_cloud - the point cloud topic to use
    * @param  occupancy_data  - the result data including the point cloud
    * @param  timeout - message timeout in milliseconds
@@ -79,6 +146,7 @@ public:
   bool fromPointCloud(const std::string& point_cloud, OccupancyData& occupancy_data, int timeout = 1000);
 
   /* @brief Generates a list of occupancy voxels given a planning scene
+   *         Thread-safe, concurrent queries are processed sequentially
    * @param  planning_scene  - the planning scene
    * @param  occupancy_data  - the result data including the voxels
    * @return true on success
@@ -91,15 +159,110 @@ private:
    */
   void pclCallback(const pcl::PCLPointCloud2ConstPtr& cloud_pcl2);
 
+  /* Subscribes the point cloud topic if it's not subscribed already, requires pcl_mtx_ to be locked
+   * @param  pcl_topic - the point cloud topic
+   */
+  void subscribePointCloud(const std::string& pcl_topic);
+
+  /* Looks up the transform from the point cloud frame to the volume frame, requires pcl_mtx_ to be locked
+   * Static transforms are looked up at time 0, dynamic transforms are looked up at the point cloud stamp.
+   * @param  cloud_frame - the frame of the point cloud
+   * @param  volume_frame - the frame of the volume region
+   * @param  stamp - the point cloud stamp
+   * @param  timeout - time in seconds to wait for a dynamic transform
+   * @param  cloud_to_volume - the resulting transform
+   * @return true on success
+   */
+  bool getPointCloudTransform(const std::string& cloud_frame, const std::string& volume_frame, const ros::Time& stamp,
+                              double timeout, Eigen::Affine3f& cloud_to_volume);
+
+  /* Returns the latest point cloud received by the subscriber, requires pcl_mtx_ to be locked
+   * @return the latest point cloud or NULL if none has been received yet
+   */
+  pcl::PointCloud<pcl::PointXYZ>::Ptr getLatestPointCloud();
+
+  /* Generates occupancy voxels by rasterizing the collision objects of the world.
+   * Voxels of unchanged collision objects are reused from previous queries.
+   * @param  world - the collision world containing the collision objects
+   * @param  world_to_volume - the world pose of the volume origin corner
+   * @param  voxels - the occupancy voxels result
+   */
+  void voxelizeWorldObjects(const collision_detection::World& world, const WorldTransform& world_to_volume,
+                            std::vector<rtr::Voxel>& voxels);
+
+  // Parameters that determine the occupancy voxels of a planning scene query, used for identifying cached results
+  struct OccupancyQueryKey
+  {
+    std::size_t hash = 0;
+    std::vector<std::string> object_ids;
+    std::vector<double> parameters;             // voxelization method, volume region, shape parameters and poses
+    std::vector<shapes::ShapeConstPtr> meshes;  // mesh shapes, compared by content
+    bool operator==(const OccupancyQueryKey& other) const;
+  };
+
+  /* Computes the key of a planning scene query from the collision objects, the volume region and the voxelization
+   * method, requires occupancy_mtx_ to be locked
+   * @param  world - the collision world containing the collision objects
+   * @param  world_to_volume - the world pose of the volume origin corner
+   * @param  key - the resulting key
+   * @return false if the world contains shapes that can't be cached
+   */
+  bool getOccupancyQueryKey(const collision_detection::World& world, const WorldTransform& world_to_volume,
+                            OccupancyQueryKey& key) const;
+
   ros::NodeHandle nh_;
   RoadmapVolume volume_region_;
   std::string pcl_topic_;
+  VoxelizationMethod voxelization_method_ = COLLISION_CHECKS;
+  std::size_t voxelization_threads_ = 1;
+  std::mutex occupancy_mtx_;
+
+  // Voxels of a rasterized collision object
+  struct ObjectVoxels
+  {
+    // the rasterized object - MoveIt! copies objects on modification so this identifies the object revision
+    collision_detection::World::ObjectConstPtr object;
+    // linear indices of the occupied voxels
+    std::vector<std::size_t> voxel_indices;
+  };
+
+  // Incremental voxelization state
+  std::map<std::string, ObjectVoxels> object_voxels_;
+  std::vector<uint32_t> voxel_object_counts_;  // number of objects occupying each voxel
+  std::vector<rtr::Voxel> world_voxels_;       // the voxels of all objects
+  Eigen::Matrix<double, 4, 4, Eigen::DontAlign> world_voxels_volume_pose_;  // the volume pose the voxels are valid for
+  RoadmapVolume world_voxels_volume_;          // the volume region the voxels are valid for
+
+  // LRU cache of planning scene query results, most recently used first
+  struct CachedVoxels
+  {
+    OccupancyQueryKey key;
+    std::vector<rtr::Voxel> voxels;
+  };
+  std::list<CachedVoxels> occupancy_cache_;
+  std::size_t occupancy_cache_size_ = 0;
+  std::size_t cache_hits_ = 0;
+  std::size_t cache_misses_ = 0;
+
+  double pcl_max_age_ = 0.1;  // max age of point clouds in seconds
+  bool pcl_voxelization_ = false;
+
+  // TF buffer that is kept filled for all point cloud queries
+  tf2_ros::Buffer tf_buffer_;
+  tf2_ros::TransformListener tf_listener_;
+
+  // Lock-free triple buffer between the subscriber callback (writer) and pcl queries (reader)
+  // The writer fills its slot and exchanges it with the shared slot, the reader takes the shared slot if it's fresh.
+  std::array<pcl::PointCloud<pcl::PointXYZ>::Ptr, 3> pcl_buffers_;
+  std::atomic<uint8_t> pcl_shared_slot_;  // index of the shared slot, flagged if it contains a new point cloud
+  uint8_t pcl_write_slot_ = 0;
+  uint8_t pcl_read_slot_ = 1;
+  std::mutex pcl_mtx_;              // synchronizes readers
+  std::mutex pcl_notify_mtx_;       // synchronizes waiting readers with the writer
+  std::condition_variable pcl_cv_;  // notified by the writer whenever a new point cloud is published
 
-  // PCL synchronization
-  pcl::PointCloud<pcl::PointXYZ>::Ptr shared_pcl_ptr_;
-  std::mutex pcl_mtx_;
-  std::condition_variable pcl_condition_;
-  bool pcl_ready_ = false;
+  // PCL subscription, declared last so that it's shut down before the buffers are destroyed
+  ros::Subscriber pcl_sub_;
 };
 }  // namespace rtr_moveit
 
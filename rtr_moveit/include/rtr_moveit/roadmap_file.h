@@ -0,0 +1,107 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Loading of roadmap data from *.og files and from memory-mapped binary sidecar files
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_FILE_H
+#define RTR_MOVEIT_ROADMAP_FILE_H
+
+// C++
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+// rtr_moveit
+#include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/roadmap_search.h>
+
+// RapidPlan
+#include <rtr-api/RapidPlanDataTypes.hpp>
+
+namespace rtr_moveit
+{
+/** Roadmap data read from a *.og file. The data is immutable once loaded so that it can be shared by all planning
+ *  contexts without copies. */
+struct RoadmapData
+{
+  std::string og_file;
+  std::time_t modification_time;
+
+  ConfigsConstPtr configs;
+  std::vector<rtr::ToolPose> poses;
+  std::vector<rtr::EdgeInfo> edges;
+
+  // occupancy volume region and kinematic frames of the roadmap
+  RoadmapVolume volume;
+  std::string base_link_frame;
+  std::string end_effector_frame;
+};
+typedef std::shared_ptr<const RoadmapData> RoadmapDataConstPtr;
+
+/** Version of the sidecar file format, sidecars of other versions are treated as stale */
+static const std::uint32_t ROADMAP_SIDECAR_VERSION = 1;
+
+/** Returns the sidecar file path of a roadmap file, which is the roadmap file path with extension *.ogmap */
+std::string getRoadmapSidecarFile(const std::string& og_file);
+
+/** Reads roadmap data from a *.og file
+ * @param og_file - The roadmap file path
+ * @param roadmap - The returned roadmap data
+ * @return true on success
+ */
+bool loadRoadmapFile(const std::string& og_file, RoadmapData& roadmap);
+
+/** Reads roadmap data from a memory-mapped sidecar file of a roadmap file.
+ *  The sidecar is stale if the roadmap file has changed since it was generated. If only the modification time of the
+ *  roadmap file differs, the checksum of the roadmap file is compared instead.
+ * @param sidecar_file - The sidecar file path
+ * @param og_file - The roadmap file path that the sidecar was generated from
+ * @param roadmap - The returned roadmap data
+ * @return true on success, false if the sidecar is missing, stale or corrupted
+ */
+bool loadRoadmapSidecar(const std::string& sidecar_file, const std::string& og_file, RoadmapData& roadmap);
+
+/** Writes roadmap data to a sidecar file, the file is replaced atomically
+ * @param roadmap - The roadmap data loaded from roadmap.og_file
+ * @param sidecar_file - The sidecar file path
+ * @return true on success
+ */
+bool writeRoadmapSidecar(const RoadmapData& roadmap, const std::string& sidecar_file);
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_FILE_H
@@ -39,11 +39,25 @@
 #ifndef RTR_MOVEIT_ROADMAP_SEARCH_H
 #define RTR_MOVEIT_ROADMAP_SEARCH_H
 
-#include <string>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include <rtr-api/RapidPlanDataTypes.hpp>  // contains rtr::Config, rtr::ToolPose
 
+#include <rtr_moveit/rtr_datatypes.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace rtr_moveit
 {
 namespace
@@ -72,6 +86,49 @@ float getPositionDistance(const rtr::ToolPose& first, const rtr::ToolPose& secon
   return std::sqrt(distance);
 }
 
+/** Compute the unit quaternion of the roll, pitch, yaw orientation of a tool pose
+ * @param pose - The tool pose as rtr::ToolPose type
+ * @return - The orientation quaternion as (w, x, y, z)
+ */
+std::array<double, 4> getOrientationQuaternion(const rtr::ToolPose& pose)
+{
+  const double cr = std::cos(0.5 * pose[3]), sr = std::sin(0.5 * pose[3]);
+  const double cp = std::cos(0.5 * pose[4]), sp = std::sin(0.5 * pose[4]);
+  const double cy = std::cos(0.5 * pose[5]), sy = std::sin(0.5 * pose[5]);
+  return { { cr * cp * cy + sr * sp * sy, sr * cp * cy - cr * sp * sy, cr * sp * cy + sr * cp * sy,
+             cr * cp * sy - sr * sp * cy } };
+}
+
+/** Compute the rotation angle between two orientations given as unit quaternions
+ * @param first, second - The pair of orientation quaternions
+ * @return - The angle of the rotation between first and second in [0, pi]
+ */
+double getQuaternionDistance(const std::array<double, 4>& first, const std::array<double, 4>& second)
+{
+  double dot = 0.0;
+  for (std::size_t i = 0; i < 4; ++i)
+    dot += first[i] * second[i];
+  // q and -q are the same orientation, the rotation angle is twice the angle between the quaternions which is
+  // computed with atan2 since it is accurate for small angles unlike acos
+  const double sign = dot < 0.0 ? -1.0 : 1.0;
+  double difference = 0.0, sum = 0.0;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    difference += std::pow(first[i] - sign * second[i], 2);
+    sum += std::pow(first[i] + sign * second[i], 2);
+  }
+  return 4.0 * std::atan2(std::sqrt(difference), std::sqrt(sum));
+}
+
+/** Compute the absolute orientation distance between two tool poses
+ * @param first, second - The pair of tool poses as rtr::ToolPose types
+ * @return - The rotation angle between the orientations of first and second in rad
+ */
+float getOrientationDistance(const rtr::ToolPose& first, const rtr::ToolPose& second)
+{
+  return getQuaternionDistance(getOrientationQuaternion(first), getOrientationQuaternion(second));
+}
+
 /** Template definition of a distance function between two items of tye T
  * @param first, second - The pair of items of type T
  * @return - The absolute distance between first and second
@@ -99,8 +156,50 @@ float getDistance<rtr::ToolPose>(const rtr::ToolPose& first, const rtr::ToolPose
   return getPositionDistance(first, second);
 }
 
-/** Template implementation of a distance-based search of item type T using getDistance<T>(T, T).
+/** Template definition of a distance function between two items of type T that may stop early at a cutoff
+ * @param first, second - The pair of items of type T
+ * @param cutoff - The distance at which the computation may stop
+ * @return - The absolute distance between first and second if it is below cutoff, otherwise a value >= cutoff
+ */
+template <class T>
+float getDistance(const T&, const T&, float cutoff);
+
+/** Template implementation for computing the absolute distance between two joint state configurations that stops
+ *  accumulating joint distances once the cutoff is reached
+ * @param first, second - The pair of joint states as Config types
+ * @param cutoff - The distance at which the computation stops
+ * @return - The absolute joint state distance between first and second if it is below cutoff, otherwise a value >=
+ * cutoff
+ */
+template <>
+float getDistance<rtr::Config>(const rtr::Config& first, const rtr::Config& second, float cutoff)
+{
+  // same summation order as getConfigDistance(), partial sums never decrease. The cutoff is only checked every four
+  // joints, per-joint checks cause more branch mispredictions than they save for typical 6-7 DOF arms.
+  float distance = 0.0;
+  for (std::size_t i = 0; i < first.size(); ++i)
+  {
+    distance += std::abs(first[i] - second[i]);
+    if ((i & 3) == 3 && distance >= cutoff)
+      break;
+  }
+  return distance;
+}
+
+/** Template implementation for computing the absolute position distance between two tool poses, the cutoff is ignored
+ *  since there are only three summands
+ * @param first, second - The pair of tool poses as rtr::ToolPose types
+ * @return - The absolute tool pose distance between first and second
+ */
+template <>
+float getDistance<rtr::ToolPose>(const rtr::ToolPose& first, const rtr::ToolPose& second, float)
+{
+  return getPositionDistance(first, second);
+}
+
+/** Template implementation of a distance-based search of item type T using getDistance<T>(T, T, float).
 * Find indices and distances of n closest items within a position distance threshold to a given item.
+* The closest items are kept in a bounded max heap, distance computations stop once they exceed the worst item.
 * @param item - The item to compare
 * @param item - The list of items to search in
 * @param result_ids - The indices of the closest items with distances in increasing order
@@ -115,36 +214,37 @@ void findClosest(const T& item, const std::vector<T>& items, std::vector<std::si
 {
   result_ids.clear();
   result_distances.clear();
-  if (!items.empty() && max_results != 0 && distance_threshold > 0.0)
+  if (items.empty() || max_results == 0 || !(distance_threshold > 0.0))
+    return;
+
+  // max heap of (distance, index), items are visited in index order so items with equal distances are ordered by
+  // index if new items are only added if they are strictly closer than the worst item
+  std::vector<std::pair<float, std::size_t>> candidates;
+  candidates.reserve(std::min(max_results, items.size()));
+  float cutoff = distance_threshold;
+  for (std::size_t item_id = 0; item_id < items.size(); ++item_id)
   {
-    // iterate items
-    for (std::size_t item_id = 0; item_id < items.size(); ++item_id)
+    float distance = getDistance<T>(item, items[item_id], cutoff);
+    if (!(distance < cutoff))
+      continue;
+    if (candidates.size() == max_results)
     {
-      float distance = getDistance<T>(item, items[item_id]);
-      int insert_position = 0;
-      bool add_to_results = result_ids.empty();  // if empty, we don't need to compare
-      if (!add_to_results)
-      {
-        for (insert_position = result_distances.size(); insert_position > 0; insert_position--)
-        {
-          if (distance < result_distances[insert_position - 1])
-            add_to_results = true;
-          else
-            break;
-        }
-      }
-      // add to results
-      if (add_to_results && distance < distance_threshold)
-      {
-        result_distances.insert(result_distances.begin() + insert_position, distance);
-        result_ids.insert(result_ids.begin() + insert_position, item_id);
-        if (result_distances.size() > max_results)
-        {
-          result_ids.pop_back();
-          result_distances.pop_back();
-        }
-      }
+      std::pop_heap(candidates.begin(), candidates.end());
+      candidates.pop_back();
     }
+    candidates.emplace_back(distance, item_id);
+    std::push_heap(candidates.begin(), candidates.end());
+    if (candidates.size() == max_results)
+      cutoff = candidates.front().first;
+  }
+
+  std::sort_heap(candidates.begin(), candidates.end());
+  result_ids.reserve(candidates.size());
+  result_distances.reserve(candidates.size());
+  for (const std::pair<float, std::size_t>& candidate : candidates)
+  {
+    result_distances.push_back(candidate.first);
+    result_ids.push_back(candidate.second);
   }
 }
 
@@ -237,6 +337,730 @@ std::ptrdiff_t findClosestConfigId(const rtr::Config& config, const std::vector<
   return result_ids.empty() ? -1 : result_ids[0];
 }
 }  // namespace
+
+/** Joint distance metric policies, see JointDistanceMetric.
+ *  Each joint contributes the term weight * |first - second|. Terms are accumulated in joint order with accumulate(),
+ *  which never decreases the accumulated value, and finish() converts the accumulated value into the distance.
+ *  Searches are instantiated per policy, so that distance loops don't branch on the metric type.
+ */
+struct L1Metric
+{
+  template <typename T>
+  static T accumulate(T sum, T term)
+  {
+    return sum + term;
+  }
+
+  /** Replaces a term of an accumulated value by a larger term */
+  template <typename T>
+  static T replace(T sum, T old_term, T new_term)
+  {
+    return sum - old_term + new_term;
+  }
+
+  template <typename T>
+  static T finish(T sum)
+  {
+    return sum;
+  }
+
+  /** Returns the accumulated value above which distances are guaranteed to exceed cutoff */
+  static float getAccumulatedCutoff(float cutoff)
+  {
+    return cutoff;
+  }
+
+#if defined(__AVX2__)
+  static __m256 accumulate(__m256 sum, __m256 term)
+  {
+    return _mm256_add_ps(sum, term);
+  }
+#elif defined(__SSE2__)
+  static __m128 accumulate(__m128 sum, __m128 term)
+  {
+    return _mm_add_ps(sum, term);
+  }
+#endif
+};
+
+struct L2Metric
+{
+  template <typename T>
+  static T accumulate(T sum, T term)
+  {
+    return sum + term * term;
+  }
+
+  template <typename T>
+  static T replace(T sum, T old_term, T new_term)
+  {
+    return std::max<T>(0, sum - old_term * old_term + new_term * new_term);
+  }
+
+  template <typename T>
+  static T finish(T sum)
+  {
+    return std::sqrt(sum);
+  }
+
+  static float getAccumulatedCutoff(float cutoff)
+  {
+    // relaxed so that rounding of the square root can't reject distances below cutoff
+    double squared_cutoff = double(cutoff) * cutoff * (1.0 + 1e-6);
+    return squared_cutoff < FLT_MAX ? float(squared_cutoff) : std::numeric_limits<float>::infinity();
+  }
+
+#if defined(__AVX2__)
+  static __m256 accumulate(__m256 sum, __m256 term)
+  {
+    return _mm256_add_ps(sum, _mm256_mul_ps(term, term));
+  }
+#elif defined(__SSE2__)
+  static __m128 accumulate(__m128 sum, __m128 term)
+  {
+    return _mm_add_ps(sum, _mm_mul_ps(term, term));
+  }
+#endif
+};
+
+struct LInfMetric
+{
+  template <typename T>
+  static T accumulate(T sum, T term)
+  {
+    return std::max(sum, term);
+  }
+
+  template <typename T>
+  static T replace(T sum, T, T new_term)
+  {
+    return std::max(sum, new_term);
+  }
+
+  template <typename T>
+  static T finish(T sum)
+  {
+    return sum;
+  }
+
+  static float getAccumulatedCutoff(float cutoff)
+  {
+    return cutoff;
+  }
+
+#if defined(__AVX2__)
+  static __m256 accumulate(__m256 sum, __m256 term)
+  {
+    return _mm256_max_ps(term, sum);
+  }
+#elif defined(__SSE2__)
+  static __m128 accumulate(__m128 sum, __m128 term)
+  {
+    return _mm_max_ps(term, sum);
+  }
+#endif
+};
+
+/** Compute the weighted distance between two joint state configurations.
+ *  DOF fixes the joint dimension at compile time so that the loop is unrolled, 0 uses the dimension argument.
+ * @param first, second - The joint values of the configurations
+ * @param weights - The joint weights
+ * @param dimension - The joint dimension
+ * @return - The joint state distance between first and second
+ */
+template <class Metric, std::size_t DOF = 0>
+float getJointDistance(const float* first, const float* second, const float* weights, std::size_t dimension)
+{
+  assert(DOF == 0 || DOF == dimension);
+  float sum = 0.0;
+  for (std::size_t d = 0; d < (DOF != 0 ? DOF : dimension); ++d)
+    sum = Metric::accumulate(sum, weights[d] * std::abs(first[d] - second[d]));
+  return Metric::finish(sum);
+}
+
+/** Compute the distance between two joint state configurations with a given metric
+ * @param first, second - The pair of joint states as Config types
+ * @param metric - The joint distance metric
+ * @return - The joint state distance between first and second
+ */
+inline float getJointDistance(const rtr::Config& first, const rtr::Config& second, const JointDistanceMetric& metric)
+{
+  const std::vector<float> weights = metric.getWeights(first.size());
+  switch (metric.type)
+  {
+    case JointDistanceMetric::L2:
+      return getJointDistance<L2Metric>(first.data(), second.data(), weights.data(), first.size());
+    case JointDistanceMetric::L_INF:
+      return getJointDistance<LInfMetric>(first.data(), second.data(), weights.data(), first.size());
+    default:
+      return getJointDistance<L1Metric>(first.data(), second.data(), weights.data(), first.size());
+  }
+}
+
+/** Contiguous store of roadmap configs for vectorized distance computations.
+ *  Configs are stored in blocks of BLOCK_SIZE configs with the values of each joint stored consecutively, so that
+ *  the distances of all configs of a block are computed at once with AVX2 or SSE instructions. Unused slots of a
+ *  block are filled with infinite values and never match a query, so metric weights need to be positive.
+ *  Kernels are instantiated for a fixed number of joints (DOF) with unrolled joint loops, the instantiation for
+ *  6 and 7 DOF roadmaps is chosen when the store is created. Other dimensions use the generic kernels (DOF = 0).
+ */
+class ConfigStore
+{
+public:
+  static constexpr std::size_t BLOCK_SIZE = 8;
+  // number of blocks that batched queries search together, small enough to stay in the L2 cache
+  static constexpr std::size_t TILE_BLOCKS = 256;
+
+  /** Creates an empty store
+   * @param dimension - The joint dimension of the stored configs
+   */
+  explicit ConfigStore(std::size_t dimension = 0) : dimension_(dimension)
+  {
+    initSearchFunctions();
+  }
+
+  /** Creates a store that contains all configs, config ids are the indices in configs
+   * @param configs - The roadmap configs, all configs must have the same dimension
+   */
+  explicit ConfigStore(const std::vector<rtr::Config>& configs);
+
+  /** Reserves memory for a number of configs */
+  void reserve(std::size_t num_configs);
+
+  /** Appends a config to the last block
+   * @param config - The joint state config, must have the dimension of the store
+   * @param id - The id that is returned by queries for this config
+   */
+  void append(const rtr::Config& config, std::size_t id);
+
+  /** Leaves the remaining slots of the last block unused, so that the next config starts a new block */
+  void finishBlock()
+  {
+    size_ = ids_.size();
+  }
+
+  /** Returns the number of stored configs including unused slots of finished blocks */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  /** Returns the joint dimension of the stored configs */
+  std::size_t dimension() const
+  {
+    return dimension_;
+  }
+
+  /** Returns the number of blocks */
+  std::size_t numBlocks() const
+  {
+    return ids_.size() / BLOCK_SIZE;
+  }
+
+  /** Computes the distances between a config and all configs of a block.
+   *  Each distance is accumulated in joint order like getJointDistance(), so results are equal to the scalar
+   *  distances. The computation stops early if all distances exceed the cutoff.
+   * @param config - The joint values of the query config
+   * @param weights - The joint weights
+   * @param block - The block index
+   * @param cutoff - The distance at which configs are rejected
+   * @param distances - The returned distances of the block configs, only valid if the function returns true
+   * @return false if all distances of the block exceed cutoff
+   */
+  template <class Metric, std::size_t DOF = 0>
+  bool getBlockDistances(const float* config, const float* weights, std::size_t block, float cutoff,
+                         float* distances) const;
+
+  /** Adds the configs of a block range to a max heap of the closest candidates ordered by distance and id.
+   * @param config - The joint values of the query config
+   * @param weights - The joint weights
+   * @param begin_block, end_block - The range of blocks to search
+   * @param max_results - The maximum number of candidates
+   * @param distance_threshold - The allowed distance of candidates from config
+   * @param candidates - The candidate heap
+   */
+  template <class Metric, std::size_t DOF = 0>
+  void searchBlocks(const float* config, const float* weights, std::size_t begin_block, std::size_t end_block,
+                    std::size_t max_results, float distance_threshold,
+                    std::vector<std::pair<float, std::size_t>>& candidates) const;
+
+  /** Find ids and distances of n closest configs within a distance threshold to a given joint config.
+   *  Returns the same results as findClosestConfigs() for a store that was created from a list of configs and the
+   *  default metric. If the dimension of config does not fit, result_ids and result_distances are empty.
+   * @param config - The joint state config to compare
+   * @param result_ids - The ids of the closest configs with distances in increasing order
+   * @param result_distances - The distances of the result configs in increasing order
+   * @param max_results - The maximum size of the result set
+   * @param distance_threshold - The allowed distance of result configs from config
+   * @param metric - The joint distance metric
+   */
+  void findClosest(const rtr::Config& config, std::vector<std::size_t>& result_ids,
+                   std::vector<float>& result_distances, const std::size_t max_results = 1,
+                   const float& distance_threshold = FLT_MAX,
+                   const JointDistanceMetric& metric = JointDistanceMetric()) const;
+
+  /** Find ids and distances of n closest configs for each config of a batch of query configs.
+   *  The store is searched in tiles of TILE_BLOCKS blocks, each tile is searched for all queries before the next tile
+   *  is loaded so that the roadmap is only streamed through memory once. With multiple threads, the tiles are split
+   *  into ranges that are searched in parallel and the results of all ranges are merged.
+   *  Results are equal to the results of findClosest() for each query, queries with a different dimension than the
+   *  store have empty results.
+   * @param configs - The joint state configs to compare
+   * @param result_ids - The ids of the closest configs for each query with distances in increasing order
+   * @param result_distances - The distances of the result configs for each query in increasing order
+   * @param max_results - The maximum size of the result set of each query
+   * @param distance_threshold - The allowed distance of result configs from the query configs
+   * @param metric - The joint distance metric
+   * @param num_threads - The number of threads to use
+   */
+  void findClosestBatch(const std::vector<rtr::Config>& configs, std::vector<std::vector<std::size_t>>& result_ids,
+                        std::vector<std::vector<float>>& result_distances, const std::size_t max_results = 1,
+                        const float& distance_threshold = FLT_MAX,
+                        const JointDistanceMetric& metric = JointDistanceMetric(), std::size_t num_threads = 1) const;
+
+private:
+  typedef void (ConfigStore::*SearchFunction)(const float*, const float*, std::size_t, std::size_t, std::size_t, float,
+                                              std::vector<std::pair<float, std::size_t>>&) const;
+
+  /** Selects the searchBlocks() instantiations for the joint dimension */
+  void initSearchFunctions();
+
+  template <std::size_t DOF>
+  void setSearchFunctions();
+
+  std::array<SearchFunction, 3> search_functions_;  // searchBlocks() per metric type
+  std::size_t dimension_;
+  std::size_t size_ = 0;
+  std::vector<float> values_;     // joint values, ordered by block, joint and lane
+  std::vector<std::size_t> ids_;  // config ids, ordered by block and lane
+};
+
+typedef std::shared_ptr<const std::vector<rtr::Config>> ConfigsConstPtr;
+
+/** Compact store of roadmap configs with joint values encoded as 16 bit fixed-point numbers.
+ *  Each joint is scaled to the range of its values in the roadmap, so the store needs half the memory of a ConfigStore
+ *  and scans stream half the data. Codes are stored in blocks of BLOCK_SIZE configs like ConfigStore.
+ *  Queries first compute lower bounds of the distances from the codes, the bounds subtract one code step per joint to
+ *  cover the encoding error of query and config. Only configs whose bound is within the current candidate bound are
+ *  re-ranked with their exact float distance, so results are equal to the results of a ConfigStore.
+ *  The float configs used for re-ranking are shared with the owner of the store.
+ */
+class QuantizedConfigStore
+{
+public:
+  static constexpr std::size_t BLOCK_SIZE = 16;
+
+  /** Creates an empty store for the configs of a roadmap, the joint ranges of the encoding are taken from all configs
+   * @param configs - The roadmap configs, all configs must have the same dimension
+   */
+  explicit QuantizedConfigStore(const ConfigsConstPtr& configs = ConfigsConstPtr());
+
+  /** Reserves memory for a number of configs */
+  void reserve(std::size_t num_configs);
+
+  /** Appends a roadmap config to the last block
+   * @param id - The index of the config in the roadmap configs, queries return this id
+   */
+  void append(std::size_t id);
+
+  /** Leaves the remaining slots of the last block unused, so that the next config starts a new block */
+  void finishBlock()
+  {
+    size_ = ids_.size();
+  }
+
+  /** Returns the number of stored configs including unused slots of finished blocks */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  /** Returns the joint dimension of the stored configs */
+  std::size_t dimension() const
+  {
+    return dimension_;
+  }
+
+  /** Returns the number of blocks */
+  std::size_t numBlocks() const
+  {
+    return ids_.size() / BLOCK_SIZE;
+  }
+
+  /** Returns the roadmap configs that are used for re-ranking */
+  const ConfigsConstPtr& getConfigs() const
+  {
+    return configs_;
+  }
+
+  /** Encodes a query config for getBlockLowerBounds()
+   * @param config - The joint values of the query config
+   * @param weights - The joint weights
+   * @param codes - The returned joint codes of config
+   * @param factors - The returned weights of one code step per joint
+   */
+  void encodeQuery(const float* config, const float* weights, std::uint16_t* codes, float* factors) const;
+
+  /** Computes lower bounds of the distances between a query and all configs of a block.
+   *  The computation stops early if all bounds exceed the cutoff.
+   * @param codes, factors - The encoded query, see encodeQuery()
+   * @param block - The block index
+   * @param cutoff - The distance at which configs are rejected
+   * @param bounds - The returned accumulated metric values of the block configs, only valid if the function returns
+   *                 true
+   * @return false if all bounds of the block exceed cutoff
+   */
+  template <class Metric, std::size_t DOF = 0>
+  bool getBlockLowerBounds(const std::uint16_t* codes, const float* factors, std::size_t block, float cutoff,
+                           float* bounds) const;
+
+  /** Adds the configs of a block range to a max heap of the closest candidates ordered by distance and id.
+   * @param config - The joint values of the query config
+   * @param weights - The joint weights
+   * @param codes, factors - The encoded query, see encodeQuery()
+   * @param begin_block, end_block - The range of blocks to search
+   * @param max_results - The maximum number of candidates
+   * @param distance_threshold - The allowed distance of candidates from config
+   * @param candidates - The candidate heap
+   */
+  template <class Metric, std::size_t DOF = 0>
+  void searchBlocks(const float* config, const float* weights, const std::uint16_t* codes, const float* factors,
+                    std::size_t begin_block, std::size_t end_block, std::size_t max_results, float distance_threshold,
+                    std::vector<std::pair<float, std::size_t>>& candidates) const;
+
+  /** Find ids and distances of n closest configs within a distance threshold to a given joint config.
+   *  Returns the same results as ConfigStore::findClosest() for a store with the same configs and ids.
+   *  If the dimension of config does not fit, result_ids and result_distances are empty.
+   * @param config - The joint state config to compare
+   * @param result_ids - The ids of the closest configs with distances in increasing order
+   * @param result_distances - The distances of the result configs in increasing order
+   * @param max_results - The maximum size of the result set
+   * @param distance_threshold - The allowed distance of result configs from config
+   * @param metric - The joint distance metric
+   */
+  void findClosest(const rtr::Config& config, std::vector<std::size_t>& result_ids,
+                   std::vector<float>& result_distances, const std::size_t max_results = 1,
+                   const float& distance_threshold = FLT_MAX,
+                   const JointDistanceMetric& metric = JointDistanceMetric()) const;
+
+private:
+  typedef void (QuantizedConfigStore::*SearchFunction)(const float*, const float*, const std::uint16_t*, const float*,
+                                                       std::size_t, std::size_t, std::size_t, float,
+                                                       std::vector<std::pair<float, std::size_t>>&) const;
+  static constexpr std::uint32_t UNUSED_ID = std::numeric_limits<std::uint32_t>::max();  // id of unused slots
+
+  /** Returns the code of a joint value, values outside of the joint range are clamped */
+  std::uint16_t encode(float value, std::size_t d) const;
+
+  template <std::size_t DOF>
+  void setSearchFunctions();
+
+  std::array<SearchFunction, 3> search_functions_;  // searchBlocks() per metric type
+  ConfigsConstPtr configs_;
+  std::size_t dimension_;
+  std::size_t size_ = 0;
+  std::vector<double> offsets_;       // joint value of code 0 per joint
+  std::vector<double> scales_;        // joint value step of one code per joint
+  std::vector<std::uint16_t> codes_;  // joint codes, ordered by block, joint and lane
+  std::vector<std::uint32_t> ids_;    // config ids, ordered by block and lane
+};
+
+/** K-d tree index over roadmap configs for joint space nearest neighbor queries.
+ *  Distances are computed with getJointDistance() for the metric of the query, with the default metric queries return
+ *  the same results as findClosestConfigs(). Items with equal distances are ordered by index. The configs are copied
+ *  into a ConfigStore that is ordered by tree leaves with each leaf starting at a new block, so the index does not
+ *  reference the original configs. Like ConfigStore, the search is instantiated for 6 and 7 DOF roadmaps.
+ *  Quantized indices store the leaves in a QuantizedConfigStore instead, which needs half the memory and shares the
+ *  configs for re-ranking with the owners of the index. Results are the same.
+ */
+class ConfigIndex
+{
+public:
+  /** Builds the index
+   * @param configs - The roadmap configs, all configs must have the same dimension
+   * @param leaf_size - The maximum number of configs in a leaf node
+   */
+  ConfigIndex(const std::vector<rtr::Config>& configs, std::size_t leaf_size = 16)
+    : dimension_(configs.empty() ? 0 : configs[0].size())
+    , leaf_size_(std::max<std::size_t>(leaf_size, 1))
+    , size_(configs.size())
+    , quantized_(false)
+    , store_(dimension_)
+  {
+    build(configs);
+  }
+
+  /** Builds the index for shared roadmap configs that are kept by the index
+   * @param configs - The roadmap configs, all configs must have the same dimension
+   * @param quantized - If true, the leaves are stored with 16 bit joint values and re-ranked with configs
+   * @param leaf_size - The maximum number of configs in a leaf node
+   */
+  ConfigIndex(const ConfigsConstPtr& configs, bool quantized, std::size_t leaf_size = 16)
+    : dimension_(configs->empty() ? 0 : configs->front().size())
+    , leaf_size_(std::max<std::size_t>(leaf_size, 1))
+    , size_(configs->size())
+    , quantized_(quantized)
+    , configs_(configs)
+    , store_(dimension_)
+    , quantized_store_(quantized ? configs : ConfigsConstPtr())
+  {
+    build(*configs);
+  }
+
+  /** Returns the number of indexed configs */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  /** Returns the joint dimension of the indexed configs */
+  std::size_t dimension() const
+  {
+    return dimension_;
+  }
+
+  /** Returns true if the leaves are stored in a QuantizedConfigStore */
+  bool isQuantized() const
+  {
+    return quantized_;
+  }
+
+  /** Returns the shared roadmap configs, null if the index was built from a config list */
+  const ConfigsConstPtr& getConfigs() const
+  {
+    return configs_;
+  }
+
+  /** Find indices and distances of n closest configs within a distance threshold to a given joint config.
+   *  If the dimension of config does not fit, result_ids and result_distances are empty.
+   * @param config - The joint state config to compare
+   * @param result_ids - The indices of the closest configs with distances in increasing order
+   * @param result_distances - The distances of the result configs in increasing order
+   * @param max_results - The maximum size of the result set
+   * @param distance_threshold - The allowed distance of result configs from config
+   * @param metric - The joint distance metric
+   */
+  void findClosest(const rtr::Config& config, std::vector<std::size_t>& result_ids,
+                   std::vector<float>& result_distances, const std::size_t max_results = 1,
+                   const float& distance_threshold = FLT_MAX,
+                   const JointDistanceMetric& metric = JointDistanceMetric()) const;
+
+  /** Find indices and distances of all configs within a distance threshold to a given joint config.
+   * @param config - The joint state config to compare
+   * @param result_ids - The indices of the configs with distances in increasing order
+   * @param result_distances - The distances of the result configs in increasing order
+   * @param distance_threshold - The allowed distance of result configs from config
+   * @param metric - The joint distance metric
+   */
+  void findWithinDistance(const rtr::Config& config, std::vector<std::size_t>& result_ids,
+                          std::vector<float>& result_distances, const float& distance_threshold,
+                          const JointDistanceMetric& metric = JointDistanceMetric()) const
+  {
+    findClosest(config, result_ids, result_distances, size_, distance_threshold, metric);
+  }
+
+  /** Find and return the index of the config with the minimal distance to a given joint state config
+   * @param config - The joint state config to compare
+   * @param distance_threshold - The allowed distance of the result config from config
+   * @param metric - The joint distance metric
+   * @return - The index of the closest config, -1 if there is none within the threshold
+   */
+  std::ptrdiff_t findClosestId(const rtr::Config& config, const float& distance_threshold = FLT_MAX,
+                               const JointDistanceMetric& metric = JointDistanceMetric()) const;
+
+  /** Find indices and distances of n closest configs for each config of a batch of query configs.
+   *  Queries are distributed to the threads in chunks, results are equal to the results of findClosest().
+   * @param configs - The joint state configs to compare
+   * @param result_ids - The indices of the closest configs for each query with distances in increasing order
+   * @param result_distances - The distances of the result configs for each query in increasing order
+   * @param max_results - The maximum size of the result set of each query
+   * @param distance_threshold - The allowed distance of result configs from the query configs
+   * @param metric - The joint distance metric
+   * @param num_threads - The number of threads to use
+   */
+  void findClosestBatch(const std::vector<rtr::Config>& configs, std::vector<std::vector<std::size_t>>& result_ids,
+                        std::vector<std::vector<float>>& result_distances, const std::size_t max_results = 1,
+                        const float& distance_threshold = FLT_MAX,
+                        const JointDistanceMetric& metric = JointDistanceMetric(), std::size_t num_threads = 1) const;
+
+private:
+  /** State of a nearest neighbor query */
+  struct Query
+  {
+    const float* config;
+    const float* weights;
+    std::size_t max_results;
+    float distance_threshold;
+    std::vector<double> offsets;  // weighted per-dimension distances of the query to the current node's region
+    std::vector<std::pair<float, std::size_t>> candidates;  // max heap ordered by distance and index
+    std::vector<std::uint16_t> codes;  // encoded query of quantized indices
+    std::vector<float> factors;
+  };
+
+  struct Node
+  {
+    std::size_t begin;  // range of the node's configs in the build order, block range in store_ for leaves
+    std::size_t end;
+    std::size_t split_dimension;
+    float split_value;
+    std::size_t children[2];  // node indices of the lower and upper half, 0 for leaves
+  };
+
+  /** Builds the tree and copies the configs in leaf order, node ranges are converted to block ranges */
+  void build(const std::vector<rtr::Config>& configs);
+
+  /** Recursively splits the configs in ids[begin, end) at the median of the dimension with the largest spread */
+  std::size_t buildNode(const std::vector<rtr::Config>& configs, std::vector<std::size_t>& ids, std::size_t begin,
+                        std::size_t end);
+
+  /** Returns the distance bound that candidates need to satisfy, relaxed by a small tolerance since lower bounds are
+   *  accumulated in a different order than the candidate distances */
+  static double getPruningBound(const Query& query);
+
+  /** Searches the node for closest configs, skipping subtrees whose distance lower bound exceeds the current
+   *  candidates
+   * @param lower_bound - The accumulated metric value of the query offsets to the node's region
+   */
+  template <class Metric, std::size_t DOF>
+  void searchNode(std::size_t node_index, double lower_bound, Query& query) const;
+
+  typedef void (ConfigIndex::*SearchFunction)(std::size_t, double, Query&) const;
+
+  /** Selects the searchNode() instantiations for a fixed joint dimension, 0 selects the generic instantiations */
+  template <std::size_t DOF>
+  void setSearchFunctions();
+
+  std::array<SearchFunction, 3> search_functions_;  // searchNode() per metric type, chosen by the joint dimension
+  std::size_t dimension_;
+  std::size_t leaf_size_;
+  std::size_t size_;
+  std::vector<Node> nodes_;
+  bool quantized_;
+  ConfigsConstPtr configs_;
+  ConfigStore store_;                     // configs in leaf order
+  QuantizedConfigStore quantized_store_;  // configs in leaf order of quantized indices
+};
+typedef std::shared_ptr<const ConfigIndex> ConfigIndexConstPtr;
+
+/** Uniform grid index over roadmap tool poses.
+ *  Poses are bucketed into cubic cells by position, so that queries only visit cells close to the query position.
+ *  Inside each cell, poses are grouped into bins by the direction of their tool z-axis. The angle between the tool axes
+ *  of two poses never exceeds their orientation distance, so bins that point away from the query orientation can be
+ *  skipped without checking their poses.
+ *  findClosest() returns the same results as findClosestPositions(), distances are computed with getPositionDistance()
+ *  and poses with equal distances are ordered by index.
+ */
+class PoseIndex
+{
+public:
+  /** Builds the index
+   * @param poses - The roadmap tool poses
+   * @param poses_per_cell - The average number of poses per grid cell, determines the cell size
+   */
+  PoseIndex(const std::vector<rtr::ToolPose>& poses, double poses_per_cell = 4.0);
+
+  /** Returns the number of indexed poses */
+  std::size_t size() const
+  {
+    return poses_.size();
+  }
+
+  /** Find indices and distances of n closest tool poses within a position distance threshold to a given pose.
+   * @param pose - The tool pose to compare
+   * @param result_ids - The indices of the closest poses with distances in increasing order
+   * @param result_distances - The distances of the result poses in increasing order
+   * @param max_results - The maximum size of the result set
+   * @param distance_threshold - The allowed distance of result poses from pose
+   */
+  void findClosest(const rtr::ToolPose& pose, std::vector<std::size_t>& result_ids,
+                   std::vector<float>& result_distances, const std::size_t max_results = 1,
+                   const float& distance_threshold = FLT_MAX) const;
+
+  /** Find indices of n closest tool poses within a position distance threshold to a given pose.
+   * @param pose - The tool pose to compare
+   * @param result_ids - The indices of the closest poses with distances in increasing order
+   * @param max_results - The maximum size of the result set
+   * @param distance_threshold - The allowed distance of result poses from pose
+   */
+  void findClosest(const rtr::ToolPose& pose, std::vector<std::size_t>& result_ids, const std::size_t max_results = 1,
+                   const float& distance_threshold = FLT_MAX) const;
+
+  /** Find indices and distances of all tool poses within a position distance threshold to a given pose.
+   * @param pose - The tool pose to compare
+   * @param result_ids - The indices of the poses with distances in increasing order
+   * @param result_distances - The distances of the result poses in increasing order
+   * @param distance_threshold - The allowed distance of result poses from pose
+   */
+  void findWithinDistance(const rtr::ToolPose& pose, std::vector<std::size_t>& result_ids,
+                          std::vector<float>& result_distances, const float& distance_threshold) const
+  {
+    findClosest(pose, result_ids, result_distances, poses_.size(), distance_threshold);
+  }
+
+  /** Find indices and position distances of all tool poses within a position and an orientation distance threshold to
+   *  a given pose. Orientation distances are computed with getOrientationDistance().
+   * @param pose - The tool pose to compare
+   * @param result_ids - The indices of the poses with position distances in increasing order
+   * @param result_distances - The position distances of the result poses in increasing order
+   * @param position_threshold - The allowed position distance of result poses from pose
+   * @param orientation_threshold - The allowed orientation distance of result poses from pose in rad
+   */
+  void findWithinTolerance(const rtr::ToolPose& pose, std::vector<std::size_t>& result_ids,
+                           std::vector<float>& result_distances, const float& position_threshold,
+                           const float& orientation_threshold) const;
+
+private:
+  /** A range of poses in a cell with similar tool axis directions */
+  struct OrientationBin
+  {
+    std::array<double, 3> axis;  // mean tool axis of the poses
+    double radius;               // largest angle between axis and the tool axes of the poses
+    std::size_t begin;           // pose range in ids_
+    std::size_t end;
+  };
+
+  /** Returns the tool z-axis of an orientation quaternion (w, x, y, z) */
+  static std::array<double, 3> getToolAxis(const std::array<double, 4>& q);
+
+  /** Returns the angle between two unit vectors */
+  static double getAxisAngle(const std::array<double, 3>& first, const std::array<double, 3>& second);
+
+  /** Returns the orientation bin of a tool axis. Bins are the quadrants of the six cube faces the axis points at. */
+  static std::size_t getOrientationBin(const std::array<double, 3>& axis);
+
+  /** Creates the bin of the poses in ids_ that start at begin and share the same orientation bin */
+  OrientationBin createOrientationBin(std::size_t begin, std::size_t cell_end,
+                                      const std::vector<std::size_t>& pose_bins) const;
+
+  /** Returns the grid coordinate of a position along an axis, positions outside of the grid are clamped */
+  long getCellCoordinate(double position, std::size_t axis) const;
+
+  /** Returns the grid cell of a pose position, positions outside of the grid are clamped to the closest cell */
+  std::array<long, 3> getCell(const rtr::ToolPose& pose) const;
+
+  std::size_t getCellIndex(long x, long y, long z) const
+  {
+    return (std::size_t(x) * cells_[1] + y) * cells_[2] + z;
+  }
+
+  /** Returns the distance of a pose position to a grid cell, border cells extend to infinity */
+  double getCellDistance(long x, long y, long z, const rtr::ToolPose& pose) const;
+
+  /** Adds all poses of a cell that are closer than the current candidates */
+  void searchCell(std::size_t cell_index, const rtr::ToolPose& pose, std::size_t max_results, float distance_threshold,
+                  std::vector<std::pair<float, std::size_t>>& candidates) const;
+
+  std::vector<rtr::ToolPose> poses_;
+  std::array<double, 3> min_position_ = { { 0.0, 0.0, 0.0 } };
+  std::array<long, 3> cells_ = { { 0, 0, 0 } };
+  double cell_size_ = 1.0;
+  std::vector<std::size_t> cell_starts_;              // offsets of the cell ranges in ids_
+  std::vector<std::size_t> ids_;                      // pose indices sorted by cell and orientation bin
+  std::vector<std::array<double, 4>> orientations_;  // orientation quaternions in the order of ids_
+  std::vector<std::size_t> bin_starts_;               // offsets of the cell ranges in bins_
+  std::vector<OrientationBin> bins_;                  // orientation bins sorted by cell
+};
+typedef std::shared_ptr<const PoseIndex> PoseIndexConstPtr;
 }  // namespace rtr_moveit
 
 #endif  // RTR_MOVEIT_ROADMAP_SEARCH_H
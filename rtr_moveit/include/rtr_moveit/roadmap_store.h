@@ -0,0 +1,103 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Process-wide store of roadmap data and search indices shared by all planning contexts
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_STORE_H
+#define RTR_MOVEIT_ROADMAP_STORE_H
+
+// C++
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// MoveIt!
+#include <moveit/macros/class_forward.h>
+
+// rtr_moveit
+#include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/roadmap_file.h>
+#include <rtr_moveit/roadmap_search.h>
+
+namespace rtr_moveit
+{
+MOVEIT_CLASS_FORWARD(RoadmapStore);
+
+/** Thread-safe store of roadmap data and search indices.
+ *  Each roadmap file is only parsed once and its search indices are only built once. Entries are reloaded if the
+ *  roadmap file path or modification time changes. Roadmaps are read from their sidecar files if available. */
+class RoadmapStore
+{
+public:
+  /** Returns the data of a roadmap, the roadmap file is loaded if it hasn't been loaded yet or if it has changed
+   * @param roadmap_spec - The roadmap specification containing roadmap id and file path
+   * @return the roadmap data, null if the roadmap file could not be loaded
+   */
+  RoadmapDataConstPtr getRoadmap(const RoadmapSpecification& roadmap_spec);
+
+  /** Returns the config index of a roadmap, the index is built if it doesn't exist yet
+   * @param roadmap_id - The roadmap id
+   * @param roadmap - The roadmap data returned by getRoadmap()
+   * @param quantized - If true, the index stores configs with 16 bit joint values
+   */
+  ConfigIndexConstPtr getConfigIndex(const std::string& roadmap_id, const RoadmapDataConstPtr& roadmap,
+                                     bool quantized = false);
+
+  /** Returns the pose index of a roadmap, the index is built if it doesn't exist yet
+   * @param roadmap_id - The roadmap id
+   * @param roadmap - The roadmap data returned by getRoadmap()
+   */
+  PoseIndexConstPtr getPoseIndex(const std::string& roadmap_id, const RoadmapDataConstPtr& roadmap);
+
+  /** Removes all roadmaps from the store, data in use by planning contexts stays valid */
+  void clear();
+
+private:
+  struct Entry
+  {
+    RoadmapDataConstPtr roadmap;
+    ConfigIndexConstPtr config_index;
+    PoseIndexConstPtr pose_index;
+  };
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> entries_;
+};
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_STORE_H
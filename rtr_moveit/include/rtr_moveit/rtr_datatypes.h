@@ -39,8 +39,13 @@
 #ifndef RTR_MOVEIT_RTR_DATATYPES_H
 #define RTR_MOVEIT_RTR_DATATYPES_H
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <geometry_msgs/PoseStamped.h>
 #include <geometric_shapes/shapes.h>
@@ -61,6 +66,30 @@ struct RoadmapVolume
   std::array<uint16_t, 3> voxel_resolution;
 };
 
+/** Joint distance metric used for nearest neighbor searches and roadmap edge costs.
+ *  The distance is computed from the weighted absolute joint differences, combined by sum (L1), euclidean norm (L2) or
+ *  maximum (L_INF). */
+struct JointDistanceMetric
+{
+  enum Type
+  {
+    L1,
+    L2,
+    L_INF
+  };
+  Type type = L1;
+  // per-joint weights, joints without weight use 1.0
+  std::vector<float> weights;
+
+  /** Returns the weights for a joint dimension */
+  std::vector<float> getWeights(std::size_t dimension) const
+  {
+    std::vector<float> dimension_weights(weights);
+    dimension_weights.resize(dimension, 1.0f);
+    return dimension_weights;
+  }
+};
+
 struct RoadmapSpecification
 {
   std::string roadmap_id;
@@ -69,6 +98,9 @@ struct RoadmapSpecification
 
   std::string base_link_frame;
   std::string end_effector_frame;
+
+  // joint distance metric of the planning group that uses the roadmap
+  JointDistanceMetric joint_metric;
 };
 
 struct OccupancyData
@@ -83,12 +115,172 @@ struct OccupancyData
   std::vector<rtr::Voxel> voxels;
 };
 
+/** Dense occupancy grid of a volume region with one bit per voxel.
+ *  Voxels are stored in 64 bit words in linear order of their indices (x * y_voxels + y) * z_voxels + z, which is
+ *  the order of voxel lists generated from planning scenes. Set operations require grids of equal resolution. */
+class OccupancyGrid
+{
+public:
+  OccupancyGrid() = default;
+
+  explicit OccupancyGrid(const std::array<uint16_t, 3>& resolution)
+  {
+    resize(resolution);
+  }
+
+  /** Resizes the grid to a new resolution, all voxels are cleared */
+  void resize(const std::array<uint16_t, 3>& resolution)
+  {
+    resolution_ = resolution;
+    size_ = std::size_t(resolution[0]) * resolution[1] * resolution[2];
+    words_.assign((size_ + 63) / 64, 0);
+  }
+
+  const std::array<uint16_t, 3>& getResolution() const
+  {
+    return resolution_;
+  }
+
+  /** Returns the number of voxels of the grid */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  std::size_t getIndex(uint16_t x, uint16_t y, uint16_t z) const
+  {
+    return (std::size_t(x) * resolution_[1] + y) * resolution_[2] + z;
+  }
+
+  rtr::Voxel getVoxel(std::size_t index) const
+  {
+    const std::size_t x_stride = std::size_t(resolution_[1]) * resolution_[2];
+    return rtr::Voxel(index / x_stride, (index % x_stride) / resolution_[2], index % resolution_[2]);
+  }
+
+  bool test(std::size_t index) const
+  {
+    return (words_[index >> 6] >> (index & 63)) & 1;
+  }
+
+  bool test(uint16_t x, uint16_t y, uint16_t z) const
+  {
+    return test(getIndex(x, y, z));
+  }
+
+  void set(std::size_t index)
+  {
+    words_[index >> 6] |= uint64_t(1) << (index & 63);
+  }
+
+  void set(uint16_t x, uint16_t y, uint16_t z)
+  {
+    set(getIndex(x, y, z));
+  }
+
+  void reset(std::size_t index)
+  {
+    words_[index >> 6] &= ~(uint64_t(1) << (index & 63));
+  }
+
+  /** Clears all voxels */
+  void clear()
+  {
+    std::fill(words_.begin(), words_.end(), 0);
+  }
+
+  /** Returns the number of occupied voxels */
+  std::size_t count() const
+  {
+    std::size_t count = 0;
+    for (uint64_t word : words_)
+      count += __builtin_popcountll(word);
+    return count;
+  }
+
+  /** Returns true if any voxel is occupied */
+  bool any() const
+  {
+    for (uint64_t word : words_)
+      if (word)
+        return true;
+    return false;
+  }
+
+  /** Calls visit(index) for all occupied voxels in increasing index order */
+  template <typename Visitor>
+  void forEach(Visitor visit) const
+  {
+    for (std::size_t word = 0; word < words_.size(); ++word)
+      for (uint64_t bits = words_[word]; bits; bits &= bits - 1)
+        visit(word * 64 + __builtin_ctzll(bits));
+  }
+
+  /** Sets all voxels of the list, voxels outside of the grid are ignored */
+  void fromVoxels(const std::vector<rtr::Voxel>& voxels)
+  {
+    for (const rtr::Voxel& voxel : voxels)
+      if (voxel.x < resolution_[0] && voxel.y < resolution_[1] && voxel.z < resolution_[2])
+        set(voxel.x, voxel.y, voxel.z);
+  }
+
+  /** Appends all occupied voxels to the list, ordered by x/y/z indices */
+  void toVoxels(std::vector<rtr::Voxel>& voxels) const
+  {
+    voxels.reserve(voxels.size() + count());
+    forEach([&](std::size_t index) { voxels.push_back(getVoxel(index)); });
+  }
+
+  /** Union */
+  OccupancyGrid& operator|=(const OccupancyGrid& other)
+  {
+    assert(resolution_ == other.resolution_);
+    for (std::size_t i = 0; i < words_.size(); ++i)
+      words_[i] |= other.words_[i];
+    return *this;
+  }
+
+  /** Intersection */
+  OccupancyGrid& operator&=(const OccupancyGrid& other)
+  {
+    assert(resolution_ == other.resolution_);
+    for (std::size_t i = 0; i < words_.size(); ++i)
+      words_[i] &= other.words_[i];
+    return *this;
+  }
+
+  /** Difference, clears all voxels that are occupied in other */
+  OccupancyGrid& operator-=(const OccupancyGrid& other)
+  {
+    assert(resolution_ == other.resolution_);
+    for (std::size_t i = 0; i < words_.size(); ++i)
+      words_[i] &= ~other.words_[i];
+    return *this;
+  }
+
+  bool operator==(const OccupancyGrid& other) const
+  {
+    return resolution_ == other.resolution_ && words_ == other.words_;
+  }
+
+  bool operator!=(const OccupancyGrid& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  std::array<uint16_t, 3> resolution_ = { { 0, 0, 0 } };
+  std::size_t size_ = 0;
+  std::vector<uint64_t> words_;
+};
+
 // Configuration for a MoveIt! planning group
 struct GroupConfig
 {
   std::string group_name;
   std::string default_roadmap_id;
   std::set<std::string> roadmap_ids;
+  JointDistanceMetric joint_metric;
 };
 }  // namespace rtr_moveit
 
@@ -84,6 +84,14 @@ struct RapidPlanGoal
   rtr::ToolPose tolerance;  // pose tolerance of the target state
   rtr::ToolPose weights;    // pose distance weights for ranking multiple solutions
 };
+
+// Roadmap edge collisions of a collision scene, the result of checkScene() can be used for multiple findPath() calls
+struct SceneCollisions
+{
+  RoadmapSpecification roadmap;          // the roadmap that has been checked
+  std::vector<uint8_t> edge_collisions;  // collision flags of all roadmap edges
+};
+
 class RTRPlannerInterface
 {
 public:
@@ -96,6 +104,27 @@ public:
   /** \brief Check if the RapidPlanInterface is available and the planner can receive requests */
   bool isReady() const;
 
+  /** \brief Check the roadmap edges for collisions with the occupancy data
+   * @param roadmap_spec - The roadmap to check
+   * @param occupancy_data - The collision scene
+   * @param collisions - The edge collisions of the roadmap, the buffer is reused if it is passed again
+   * @return true on success
+   */
+  bool checkScene(const RoadmapSpecification& roadmap_spec, const OccupancyData& occupancy_data,
+                  SceneCollisions& collisions);
+
+  /** \brief Search a path in a roadmap whose edge collisions have been checked with checkScene()
+   * @param collisions - The result of checkScene()
+   * @param start_state_id - The roadmap state id of the start state
+   * @param goal - The goal of the path
+   * @param timeout - The search timeout in milliseconds
+   * @param waypoints - The roadmap state ids of the solution path
+   * @param edges - The roadmap edge ids of the solution path
+   * @return true if a path was found
+   */
+  bool findPath(const SceneCollisions& collisions, const std::size_t start_state_id, const RapidPlanGoal& goal,
+                const double& timeout, std::deque<std::size_t>& waypoints, std::deque<std::size_t>& edges);
+
   /** \brief Run planning attempt and generate a solution path */
   bool solve(const RoadmapSpecification& roadmap_spec, const std::size_t start_state_id, const RapidPlanGoal& goal,
              const OccupancyData& occupancy_data, const double& timeout, std::vector<rtr::Config>& solution_path);
@@ -118,6 +147,10 @@ private:
   /** \brief load roadmap file to PathPlanner and store roadmap specification */
   bool loadRoadmapToPathPlanner(const RoadmapSpecification& roadmap_spec);
 
+  /** \brief Set the PathPlanner edge cost to a joint distance metric, requires the edge cost mutex to be locked
+   *  Weights that don't match the joint dimension of the roadmap are replaced by default weights. */
+  void setEdgeCost(const JointDistanceMetric& joint_metric, std::size_t dimension);
+
   /** \brief Initialize PathPlanner and RapidPlanInterface with a given roadmap identifier */
   bool prepareRoadmap(const RoadmapSpecification& roadmap_spec, size_t& roadmap_index);
 
@@ -150,6 +183,8 @@ private:
   std::map<std::string, RoadmapSpecification> roadmaps_;
   // name of roadmap loaded by the planner
   std::string loaded_roadmap_;
+  // joint dimension of the roadmap loaded by the planner
+  std::size_t loaded_roadmap_dimension_ = 0;
   // indices of roadmaps written to the board
   std::map<uint16_t, std::string> roadmap_indices_;
 };
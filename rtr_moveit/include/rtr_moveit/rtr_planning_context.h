@@ -40,7 +40,10 @@
 #define RTR_MOVEIT_RTR_PLANNING_CONTEXT_H
 
 // C++
+#include <cmath>
+#include <deque>
 #include <string>
+#include <vector>
 
 // MoveIt
 #include <moveit/macros/class_forward.h>
@@ -49,13 +52,36 @@
 // rtr_moveit
 #include <rtr_moveit/rtr_planner_interface.h>
 #include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/occupancy_handler.h>
+#include <rtr_moveit/roadmap_search.h>
+#include <rtr_moveit/roadmap_store.h>
 #include <rtr_moveit/roadmap_visualization.h>
 
-// RapidPlan file reader API
-#include <rtr-api/OGFileReader.hpp>
-
 namespace rtr_moveit
 {
+/** Planner parameters of the planning contexts, see rtr_moveit_tutorial for descriptions */
+struct PlannerConfig
+{
+  double allowed_joint_distance = 0.5;
+  double allowed_position_distance = 0.1;
+  double allowed_orientation_distance = M_PI;
+  double max_waypoint_distance = 0.01;
+  int max_goal_states = 5;
+  int goal_sample_batch_size = 1;
+  bool quantize_roadmap_configs = false;
+
+  // occupancy data
+  std::string occupancy_source = "PLANNING_SCENE";
+  std::string pcl_topic;
+  double pcl_max_age = 0.1;
+  bool pcl_voxelization = false;
+  OccupancyHandler::VoxelizationMethod voxelization_method = OccupancyHandler::COLLISION_CHECKS;
+  int voxelization_threads = 1;
+  int occupancy_cache_size = 4;
+
+  bool visualization_enabled = false;
+};
+
 MOVEIT_CLASS_FORWARD(RTRPlanningContext);
 
 class RTRPlanningContext : public planning_interface::PlanningContext
@@ -65,9 +91,13 @@ public:
    * @param planning_group - The name of the joint model group
    * @param roadmap_spec - Roadmap and region volume configuration for this context
    * @param planner_interface - The RTRPlannerInterface that handles RapidPlan collision checks and roadmap planning
+   * @param occupancy_handler - The OccupancyHandler that generates occupancy data inside the roadmap volume
+   * @param roadmap_store - The store of roadmap data and search indices shared by all planning contexts
+   * @param visualization - The RoadmapVisualization used for visualizing roadmap and solution data
    */
   RTRPlanningContext(const std::string& planning_group, const RoadmapSpecification& roadmap_spec,
-                     const RTRPlannerInterfacePtr& planner_interface, const RoadmapVisualizationPtr& visualization);
+                     const RTRPlannerInterfacePtr& planner_interface, const OccupancyHandlerPtr& occupancy_handler,
+                     const RoadmapStorePtr& roadmap_store, const RoadmapVisualizationPtr& visualization);
 
   /** Destructor */
   virtual ~RTRPlanningContext()
@@ -87,18 +117,37 @@ public:
    */
   virtual bool solve(planning_interface::MotionPlanDetailedResponse& res);
 
-  /** Configures the planning context which includes extracting a goal from the MotionPlanRequest
+  /** Sets the planner parameters used by following requests
+   * @param config - The planner parameters
+   */
+  void setPlannerConfig(const PlannerConfig& config)
+  {
+    config_ = config;
+  }
+
+  /** Configures the planning context for the current MotionPlanRequest and planning scene. Roadmap data is only
+   *  loaded once, so that configuring a reused context is cheap.
    * @param error_code - the result code
    */
   void configure(moveit_msgs::MoveItErrorCodes& error_code);
 
-  /** Clear the planning context data */
+  /** Clears request and planning scene so that the context can be reused, roadmap data and buffers are kept */
   virtual void clear();
 
+  /** Releases the planning scene and point cloud of the last request so that they aren't kept alive by an idle
+   *  context, the context needs to be configured again before solving */
+  void releasePlanningScene();
+
   /** Terminate the planning context - NOTE: this is not supported */
   virtual bool terminate();
 
 private:
+  /** Initializes roadmap data and search indices of the context
+   * @param roadmap_data - The roadmap data returned by the RoadmapStore
+   * @return true on success, false if the roadmap doesn't fit to the planning group
+   */
+  bool initRoadmap(const RoadmapDataConstPtr& roadmap_data);
+
   /** Runs a planning attempt on the configured context and initializes results as RobotTrajectory and planning time
    * @param  trajectory - the result RobotTrajectory
    * @param  planning_time - the elapsed planning time
@@ -126,6 +175,17 @@ private:
   bool getRapidPlanGoal(const moveit_msgs::Constraints& goal_constraint, RapidPlanGoal& goal,
                         robot_state::RobotStatePtr& goal_state);
 
+  /** Extracts the target pose of the roadmap end effector from goal constraints with a single position and/or
+   *  orientation constraint. The pose is given relative to the roadmap base link like the roadmap tool poses.
+   * @param  goal_constraint - the goal constraints to extract
+   * @param  tool_pose - the returned target pose of the end effector
+   * @param  position_tolerance - the allowed position distance, FLT_MAX if the position is not constrained
+   * @param  orientation_tolerance - the allowed orientation distance, FLT_MAX if the orientation is not constrained
+   * @return true on success, false if the constraints don't define a target pose of the roadmap end effector
+   */
+  bool getGoalToolPose(const moveit_msgs::Constraints& goal_constraint, rtr::ToolPose& tool_pose,
+                       float& position_tolerance, float& orientation_tolerance) const;
+
   /** Extracts the start state from the MotionPlanRequest and searches for a start state candidate in the roadmap.
    *  If the joint values in the MotionPlanRequest are not populated, the current state of the planning scene is used.
    *  @param start_state_id - the returned state id of the start state candidate
@@ -168,29 +228,29 @@ private:
   std::vector<robot_state::RobotStatePtr> goal_states_;
 
   const RTRPlannerInterfacePtr planner_interface_;
-  const moveit::core::JointModelGroup* jmg_;
+  const OccupancyHandlerPtr occupancy_handler_;
+  const RoadmapStorePtr roadmap_store_;
+  const moveit::core::JointModelGroup* jmg_ = nullptr;
   std::vector<std::string> joint_model_names_;
   RoadmapSpecification roadmap_;
-  std::vector<rtr::Config> roadmap_configs_;
-  std::vector<rtr::ToolPose> roadmap_poses_;
-  std::vector<rtr::EdgeInfo> roadmap_edges_;
+  RoadmapDataConstPtr roadmap_data_;  // shared with all planning contexts of the roadmap
+  ConfigIndexConstPtr config_index_;
+  PoseIndexConstPtr pose_index_;
   std::vector<RapidPlanGoal> goals_;
-  std::shared_ptr<rtr::OGFileReader> og_file_;
   bool configured_ = false;
 
+  // buffers that are reused by following requests
+  OccupancyData occupancy_data_;
+  SceneCollisions scene_collisions_;
+  std::deque<std::size_t> waypoints_;
+  std::deque<std::size_t> edges_;
+
   // parameters
-  double max_waypoint_distance_ = 0.01;
-  double allowed_joint_distance_;
-  double allowed_position_distance_;
-  int max_goal_states_;
+  PlannerConfig config_;
 
   // visualization
-  bool visualization_enabled_;
   const RoadmapVisualizationPtr visualization_;
 
-  std::string occupancy_source_;
-  std::string pcl_topic_;
-
   ros::Time terminate_plan_time_;
 };
 }  // namespace rtr_moveit
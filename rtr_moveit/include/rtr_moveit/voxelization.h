@@ -0,0 +1,101 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Author: Henning Kayser
+ * Desc: Analytic voxelization of collision shapes inside a roadmap volume region
+ */
+
+#ifndef RTR_MOVEIT_VOXELIZATION_H
+#define RTR_MOVEIT_VOXELIZATION_H
+
+// C++
+#include <array>
+#include <vector>
+
+// Eigen
+#include <Eigen/Geometry>
+
+// collision shapes
+#include <geometric_shapes/shapes.h>
+
+// rtr_moveit
+#include <rtr_moveit/rtr_datatypes.h>
+
+namespace rtr_moveit
+{
+/** Voxel x/y/z indices that span an axis-aligned section of the volume grid (both bounds inclusive) */
+struct VoxelBounds
+{
+  std::array<uint16_t, 3> min;
+  std::array<uint16_t, 3> max;
+};
+
+/** Computes the voxel bounds of all grid cells that are overlapped by the bounding box of a shape.
+ * @param shape - the collision shape
+ * @param shape_pose - the pose of the shape relative to the volume origin corner
+ * @param volume - the volume region that defines dimension and resolution of the grid
+ * @param bounds - the returned voxel bounds
+ * @return false if the shape does not overlap the volume region
+ */
+bool getShapeVoxelBounds(const shapes::Shape& shape, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                         VoxelBounds& bounds);
+
+/** Rasterizes a collision shape into the voxel grid of a volume region.
+ *  A voxel is considered occupied if its box overlaps the shape's volume (or the surface for meshes) which
+ *  corresponds to a collision check of the voxel box and the shape.
+ *  Supported shape types are BOX, SPHERE, MESH and OCTREE. OctoMaps are converted by rasterizing the occupied leaves
+ *  inside the volume region, so the runtime depends on the number of occupied leaves and not on the grid size.
+ * @param shape - the collision shape
+ * @param shape_pose - the pose of the shape relative to the volume origin corner
+ * @param volume - the volume region that defines dimension and resolution of the grid
+ * @param occupied - the occupancy grid with the resolution of the volume region, overlapped voxels are set
+ * @return false if the shape type is not supported
+ */
+bool voxelizeShape(const shapes::Shape& shape, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                   OccupancyGrid& occupied);
+
+/** Converts a point cloud into the occupancy voxels of a volume region.
+ *  Points are transformed into the volume, cropped to the volume region and quantized to voxel indices. Each
+ *  occupied voxel is returned only once, ordered by x/y/z indices. Uses AVX2 instructions if enabled at compile time.
+ * @param cloud - the point cloud
+ * @param cloud_pose - the pose of the point cloud frame relative to the volume origin corner
+ * @param volume - the volume region that defines dimension and resolution of the grid
+ * @param voxels - the occupancy voxels, new voxels are appended
+ */
+void voxelizePointCloud(const pcl::PointCloud<pcl::PointXYZ>& cloud, const Eigen::Affine3f& cloud_pose,
+                        const RoadmapVolume& volume, std::vector<rtr::Voxel>& voxels);
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_VOXELIZATION_H
@@ -0,0 +1,70 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Command line tool that generates sidecar files of roadmaps for fast loading
+ */
+
+// C++
+#include <iostream>
+#include <string>
+
+// rtr_moveit
+#include <rtr_moveit/roadmap_file.h>
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <roadmap_file.og> [<roadmap_file.og> ...]" << std::endl
+              << "Generates a sidecar file <roadmap_file.ogmap> next to each roadmap file." << std::endl;
+    return 1;
+  }
+
+  int result = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string og_file = argv[i];
+    const std::string sidecar_file = rtr_moveit::getRoadmapSidecarFile(og_file);
+    rtr_moveit::RoadmapData roadmap;
+    if (!rtr_moveit::loadRoadmapFile(og_file, roadmap) || !rtr_moveit::writeRoadmapSidecar(roadmap, sidecar_file))
+    {
+      std::cerr << "Failed to generate roadmap sidecar for " << og_file << std::endl;
+      result = 1;
+      continue;
+    }
+    std::cout << "Generated roadmap sidecar " << sidecar_file << std::endl;
+  }
+  return result;
+}
@@ -38,12 +38,18 @@
 
 #include <rtr_moveit/occupancy_handler.h>
 #include <pcl_conversions/pcl_conversions.h>
-#include <pcl_ros/transforms.h>
+#include <pcl/common/transforms.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <thread>
+#include <utility>
 
 // Eigen
 #include <Eigen/Geometry>
 #include <eigen_conversions/eigen_msg.h>
+#include <tf2_eigen/tf2_eigen.h>
 
 // collision checks
 #include <moveit/collision_detection/world.h>
@@ -53,160 +59,759 @@
 // RapidPlan
 #include <rtr-occupancy/Voxel.hpp>
 
+// rtr_moveit
+#include <rtr_moveit/voxelization.h>
+
 namespace rtr_moveit
 {
 const std::string LOGNAME = "occupancy_handler";
-OccupancyHandler::OccupancyHandler(const ros::NodeHandle& nh) : nh_(nh)
+// id of the voxel box used for collision checks - this is not visible in the planning scene
+const std::string VOXEL_BOX_ID = "rapidplan_collision_box";
+// id of the region box used for hierarchical collision checks
+const std::string REGION_BOX_ID = "rapidplan_region_box";
+
+// flag of the shared pcl buffer slot that marks a new point cloud
+const uint8_t PCL_FRESH_FLAG = 0x4;
+
+namespace
+{
+typedef OccupancyHandler::WorldTransform WorldTransform;
+
+/** Returns the number of voxels in the volume region grid */
+std::size_t getVoxelCount(const RoadmapVolume& volume)
 {
+  return std::size_t(volume.voxel_resolution[0]) * volume.voxel_resolution[1] * volume.voxel_resolution[2];
 }
 
-void OccupancyHandler::setVolumeRegion(const RoadmapVolume& roadmap_volume)
+/** Combines a hash seed with the hash of a value */
+template <typename T>
+void hashCombine(std::size_t& seed, const T& value)
 {
-  volume_region_ = roadmap_volume;
+  seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 }
 
-void OccupancyHandler::setPointCloudTopic(const std::string& pcl_topic)
+/** Combines a hash seed with the hashes of an array of values */
+template <typename T>
+void hashCombine(std::size_t& seed, const T* values, std::size_t count)
 {
-  pcl_topic_ = pcl_topic;
+  for (std::size_t i = 0; i < count; ++i)
+    hashCombine(seed, values[i]);
 }
 
-bool OccupancyHandler::fromPointCloud(const std::string& pcl_topic, OccupancyData& occupancy_data, int timeout)
+/** Appends the parameters of a shape, returns false for shapes that are too expensive to compare
+ *  Mesh parameters only contain the vertex and triangle counts, the mesh data is compared separately. */
+bool appendShapeParameters(const shapes::Shape& shape, std::vector<double>& parameters)
 {
-  // if point cloud is older than 100ms, get a new one
-  // TODO(RTR-59): Use planning time to determine timeouts
-  if (!shared_pcl_ptr_ || (ros::Time::now().toNSec() * 1000 - shared_pcl_ptr_->header.stamp > 100000))
-  {
-    std::unique_lock<std::mutex> lock(pcl_mtx_);
-    ros::Subscriber pcl_sub = nh_.subscribe(pcl_topic, 1, &OccupancyHandler::pclCallback, this);
-    pcl_ready_ = false;
-    bool pcl_success = pcl_condition_.wait_for(lock, std::chrono::milliseconds(timeout), [&]() { return pcl_ready_; });
-    pcl_sub.shutdown();
-    if (!pcl_success)
+  parameters.push_back(shape.type);
+  switch (shape.type)
+  {
+    case shapes::BOX:
     {
-      ROS_ERROR_NAMED(LOGNAME, "Waiting for point cloud data timed out");
-      return false;
+      const double* size = static_cast<const shapes::Box&>(shape).size;
+      parameters.insert(parameters.end(), size, size + 3);
+      return true;
+    }
+    case shapes::SPHERE:
+      parameters.push_back(static_cast<const shapes::Sphere&>(shape).radius);
+      return true;
+    case shapes::CYLINDER:
+      parameters.push_back(static_cast<const shapes::Cylinder&>(shape).radius);
+      parameters.push_back(static_cast<const shapes::Cylinder&>(shape).length);
+      return true;
+    case shapes::CONE:
+      parameters.push_back(static_cast<const shapes::Cone&>(shape).radius);
+      parameters.push_back(static_cast<const shapes::Cone&>(shape).length);
+      return true;
+    case shapes::PLANE:
+    {
+      const shapes::Plane& plane = static_cast<const shapes::Plane&>(shape);
+      parameters.insert(parameters.end(), { plane.a, plane.b, plane.c, plane.d });
+      return true;
     }
-    if (shared_pcl_ptr_)
+    case shapes::MESH:
     {
-      tf::TransformListener tf_listener;
-      const std::string& cloud_frame = shared_pcl_ptr_->header.frame_id;
-      const std::string& volume_frame = volume_region_.pose.header.frame_id;
-      if (!tf_listener.canTransform(volume_frame, cloud_frame, ros::Time::now()) &&
-          !tf_listener.waitForTransform(volume_frame, cloud_frame, ros::Time::now(), ros::Duration(1.0)))
+      const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(shape);
+      parameters.push_back(mesh.vertex_count);
+      parameters.push_back(mesh.triangle_count);
+      return true;
+    }
+    default:
+      // octrees change with every sensor update and are too large to compare
+      return false;
+  }
+}
+
+/** Returns true if both meshes have the same vertices and triangles */
+bool equalMeshes(const shapes::Mesh& first, const shapes::Mesh& second)
+{
+  return first.vertex_count == second.vertex_count && first.triangle_count == second.triangle_count &&
+         std::equal(first.vertices, first.vertices + 3 * first.vertex_count, second.vertices) &&
+         std::equal(first.triangles, first.triangles + 3 * first.triangle_count, second.triangles);
+}
+
+/** Returns the voxel box shape of the volume region grid */
+shapes::ShapeConstPtr createVoxelBox(const RoadmapVolume& volume)
+{
+  return std::make_shared<const shapes::Box>(volume.dimension[0] / float(volume.voxel_resolution[0]),
+                                             volume.dimension[1] / float(volume.voxel_resolution[1]),
+                                             volume.dimension[2] / float(volume.voxel_resolution[2]));
+}
+
+/** Writes all voxels of the occupancy mask to the voxel vector, ordered by x/y/z indices */
+template <typename OccupancyMask>
+void appendOccupiedVoxels(const OccupancyMask& occupied, const RoadmapVolume& volume, std::vector<rtr::Voxel>& voxels)
+{
+  std::size_t index = 0;
+  for (uint16_t x = 0; x < volume.voxel_resolution[0]; ++x)
+    for (uint16_t y = 0; y < volume.voxel_resolution[1]; ++y)
+      for (uint16_t z = 0; z < volume.voxel_resolution[2]; ++z)
+        if (occupied[index++])
+          voxels.push_back(rtr::Voxel(x, y, z));
+}
+
+/** Checks all voxels inside the bounds for collisions with a single collision shape
+ * @param shape - the collision shape
+ * @param shape_pose - the world pose of the shape
+ * @param volume - the volume region
+ * @param world_to_volume - the world pose of the volume origin corner
+ * @param bounds - the voxel bounds to check
+ * @param occupied - the occupancy grid, colliding voxels are set
+ */
+void checkShapeVoxelCollisions(const shapes::ShapeConstPtr& shape, const WorldTransform& shape_pose,
+                               const RoadmapVolume& volume, const WorldTransform& world_to_volume,
+                               const VoxelBounds& bounds, OccupancyGrid& occupied)
+{
+  // collision world only containing the shape
+  collision_detection::CollisionWorldFCL shape_world;
+  shape_world.getWorld()->addToObject("shape", shape, shape_pose);
+
+  // collision world containing the voxel box
+  collision_detection::CollisionWorldFCL voxel_world;
+  shapes::ShapeConstPtr box = createVoxelBox(volume);
+  const shapes::Box& box_shape = static_cast<const shapes::Box&>(*box);
+  voxel_world.getWorld()->addToObject(VOXEL_BOX_ID, box, world_to_volume);
+
+  collision_detection::CollisionRequest request;
+  collision_detection::CollisionResult result;
+  for (uint16_t x = bounds.min[0]; x <= bounds.max[0]; ++x)
+  {
+    for (uint16_t y = bounds.min[1]; y <= bounds.max[1]; ++y)
+    {
+      for (uint16_t z = bounds.min[2]; z <= bounds.max[2]; ++z)
       {
-        ROS_ERROR_NAMED(LOGNAME, "Unable to transform point cloud into volume region frame");
-        return false;
+        std::size_t index = occupied.getIndex(x, y, z);
+        if (occupied.test(index))
+          continue;
+        Eigen::Translation3d voxel_center((x + 0.5) * box_shape.size[0], (y + 0.5) * box_shape.size[1],
+                                          (z + 0.5) * box_shape.size[2]);
+        voxel_world.getWorld()->moveShapeInObject(VOXEL_BOX_ID, box, world_to_volume * voxel_center);
+        shape_world.checkWorldCollision(request, result, voxel_world);
+        if (result.collision)
+        {
+          occupied.set(index);
+          result.clear();
+        }
       }
-      tf::StampedTransform cloud_to_volume;
-      tf_listener.lookupTransform(volume_frame, cloud_frame, ros::Time::now(), cloud_to_volume);
-      pcl_ros::transformPointCloud(*shared_pcl_ptr_, *shared_pcl_ptr_, cloud_to_volume);
     }
-
-    // get result
-    occupancy_data.type = OccupancyData::Type::POINT_CLOUD;
-    occupancy_data.point_cloud = shared_pcl_ptr_;
   }
-  return occupancy_data.point_cloud != NULL;
 }
 
-void OccupancyHandler::pclCallback(const pcl::PCLPointCloud2ConstPtr& cloud_pcl2)
+/** Rasterizes all shapes of a collision object that overlap the volume region.
+ *  Shapes that cannot be rasterized analytically are checked for collisions inside their bounding boxes.
+ * @param collision_object - the collision object
+ * @param volume - the volume region
+ * @param world_to_volume - the world pose of the volume origin corner
+ * @param voxel_indices - the linear indices of all occupied voxels in increasing order
+ */
+void voxelizeCollisionObject(const collision_detection::World::Object& collision_object, const RoadmapVolume& volume,
+                             const WorldTransform& world_to_volume, std::vector<std::size_t>& voxel_indices)
 {
-  std::unique_lock<std::mutex> lock(pcl_mtx_);
-  // prevent overwriting shared_pcl_ptr_ in case subscriber wasn't shut down fast enough
-  if (!pcl_ready_)
+  voxel_indices.clear();
+  OccupancyGrid occupied;
+  const Eigen::Affine3d volume_to_world(world_to_volume.inverse());
+  for (std::size_t i = 0; i < collision_object.shapes_.size(); ++i)
   {
-    if (!shared_pcl_ptr_)
-      shared_pcl_ptr_.reset(new pcl::PointCloud<pcl::PointXYZ>());
-    pcl::fromPCLPointCloud2(*cloud_pcl2, *shared_pcl_ptr_);
-    pcl_ready_ = true;
-    lock.unlock();
-    pcl_condition_.notify_one();
+    // cull shapes outside of the volume region
+    const shapes::ShapeConstPtr& shape = collision_object.shapes_[i];
+    const Eigen::Affine3d shape_pose = volume_to_world * collision_object.shape_poses_[i];
+    VoxelBounds bounds;
+    if (!getShapeVoxelBounds(*shape, shape_pose, volume, bounds))
+      continue;
+
+    // the occupancy grid is only allocated for objects inside the volume region
+    if (occupied.size() == 0)
+      occupied.resize(volume.voxel_resolution);
+    if (!voxelizeShape(*shape, shape_pose, volume, occupied))
+      checkShapeVoxelCollisions(shape, collision_object.shape_poses_[i], volume, world_to_volume, bounds, occupied);
   }
+  occupied.forEach([&](std::size_t index) { voxel_indices.push_back(index); });
 }
 
-bool OccupancyHandler::fromPlanningScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
-                                         OccupancyData& occupancy_data)
+/** Checks a box region of voxels for collisions and recursively subdivides colliding regions into octants until
+ *  the region size matches the voxel size.
+ * @param collision_world - the collision world to check
+ * @param region_world - the collision world used for the region box
+ * @param volume - the volume region
+ * @param world_to_volume - the world pose of the volume origin corner
+ * @param region - the voxel bounds of the region to check
+ * @param occupied - the occupancy grid, colliding voxels are set
+ */
+void checkVoxelRegionCollisions(const collision_detection::CollisionWorld& collision_world,
+                                collision_detection::CollisionWorldFCL& region_world, const RoadmapVolume& volume,
+                                const WorldTransform& world_to_volume, const VoxelBounds& region,
+                                OccupancyGrid& occupied)
 {
-  // region volume dimensions
-  float x_length = volume_region_.dimension[0];
-  float y_length = volume_region_.dimension[1];
-  float z_length = volume_region_.dimension[2];
+  // voxel dimensions match the voxel box used in checkVoxelSlabCollisions()
+  float x_voxel_dimension = volume.dimension[0] / float(volume.voxel_resolution[0]);
+  float y_voxel_dimension = volume.dimension[1] / float(volume.voxel_resolution[1]);
+  float z_voxel_dimension = volume.dimension[2] / float(volume.voxel_resolution[2]);
 
-  // voxel resolution
-  float x_voxels = volume_region_.voxel_resolution[0];
-  float y_voxels = volume_region_.voxel_resolution[1];
-  float z_voxels = volume_region_.voxel_resolution[2];
+  // region voxel counts
+  std::array<uint16_t, 3> region_voxels;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+    region_voxels[axis] = region.max[axis] - region.min[axis] + 1;
 
-  // voxel dimensions
-  float x_voxel_dimension = x_length / x_voxels;
-  float y_voxel_dimension = y_length / y_voxels;
-  float z_voxel_dimension = z_length / z_voxels;
+  // place region box and check for collisions
+  shapes::ShapeConstPtr box = std::make_shared<const shapes::Box>(
+      region_voxels[0] * x_voxel_dimension, region_voxels[1] * y_voxel_dimension, region_voxels[2] * z_voxel_dimension);
+  Eigen::Translation3d box_center((region.min[0] + 0.5 * region_voxels[0]) * x_voxel_dimension,
+                                  (region.min[1] + 0.5 * region_voxels[1]) * y_voxel_dimension,
+                                  (region.min[2] + 0.5 * region_voxels[2]) * z_voxel_dimension);
+  region_world.getWorld()->removeObject(REGION_BOX_ID);
+  region_world.getWorld()->addToObject(REGION_BOX_ID, box, world_to_volume * box_center);
+  collision_detection::CollisionRequest request;
+  collision_detection::CollisionResult result;
+  collision_world.checkWorldCollision(request, result, region_world);
+  if (!result.collision)
+    return;
 
-  // Compute transform: world->volume
-  // world_to_volume points at the corner of the volume origin (x=0,y=0,z=0)
-  // we use auto to support Affine3d and Isometry3d (kinetic + melodic)
-  auto world_to_base(planning_scene->getFrameTransform(volume_region_.pose.header.frame_id));
-  auto base_to_volume = world_to_base;
-  tf::poseMsgToEigen(volume_region_.pose.pose, base_to_volume);
-  auto world_to_volume = world_to_base * base_to_volume;
+  // single voxel collides
+  if (region_voxels[0] == 1 && region_voxels[1] == 1 && region_voxels[2] == 1)
+  {
+    occupied.set(region.min[0], region.min[1], region.min[2]);
+    return;
+  }
 
-  // create collision world and add voxel box shape one step outside the volume grid
-  collision_detection::CollisionWorldFCL world;
-  shapes::Box box(x_voxel_dimension, y_voxel_dimension, z_voxel_dimension);
-  Eigen::Translation3d box_start_position(-0.5 * x_voxel_dimension, -0.5 * y_voxel_dimension, -0.5 * z_voxel_dimension);
+  // split region into octants, axes with a single voxel are not split
+  std::array<std::array<uint16_t, 2>, 3> lower_bounds;
+  std::array<std::array<uint16_t, 2>, 3> upper_bounds;
+  std::array<std::size_t, 3> splits;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+  {
+    uint16_t mid = region.min[axis] + region_voxels[axis] / 2;
+    splits[axis] = region_voxels[axis] > 1 ? 2 : 1;
+    lower_bounds[axis] = { { region.min[axis], mid } };
+    upper_bounds[axis] = { { uint16_t(splits[axis] > 1 ? mid - 1 : region.max[axis]), region.max[axis] } };
+  }
+  VoxelBounds octant;
+  for (std::size_t x = 0; x < splits[0]; ++x)
+  {
+    for (std::size_t y = 0; y < splits[1]; ++y)
+    {
+      for (std::size_t z = 0; z < splits[2]; ++z)
+      {
+        octant.min = { { lower_bounds[0][x], lower_bounds[1][y], lower_bounds[2][z] } };
+        octant.max = { { upper_bounds[0][x], upper_bounds[1][y], upper_bounds[2][z] } };
+        checkVoxelRegionCollisions(collision_world, region_world, volume, world_to_volume, octant, occupied);
+      }
+    }
+  }
+}
 
-  // occupancy box id and dimensions
-  // TODO(henningkayser): Check that box id is not present in planning scene - should be unique
-  std::string box_id = "rapidplan_collision_box";
-  world.getWorld()->addToObject(box_id, std::make_shared<const shapes::Box>(box), world_to_volume * box_start_position);
+/** Generates occupancy voxels by checking the voxel boxes of the x-slab [x_begin, x_end) for collisions
+ * @param collision_world - the collision world to check
+ * @param volume - the volume region
+ * @param world_to_volume - the world pose of the volume origin corner
+ * @param voxel_world - the collision world containing the voxel box
+ * @param x_begin, x_end - the x index range of the slab
+ * @param voxels - the occupancy voxels result
+ */
+void checkVoxelSlabCollisions(const collision_detection::CollisionWorld& collision_world, const RoadmapVolume& volume,
+                              const WorldTransform& world_to_volume,
+                              collision_detection::CollisionWorldFCL& voxel_world, uint16_t x_begin, uint16_t x_end,
+                              std::vector<rtr::Voxel>& voxels)
+{
+  // voxel resolution
+  float y_voxels = volume.voxel_resolution[1];
+  float z_voxels = volume.voxel_resolution[2];
 
-  // clear scene boxes vector
-  occupancy_data.type = OccupancyData::Type::VOXELS;
-  occupancy_data.voxels.resize(0);
+  // voxel dimensions
+  const shapes::ShapeConstPtr& box = voxel_world.getWorld()->getObject(VOXEL_BOX_ID)->shapes_[0];
+  const double* box_size = static_cast<const shapes::Box&>(*box).size;
+  float x_voxel_dimension = box_size[0];
+  float y_voxel_dimension = box_size[1];
+  float z_voxel_dimension = box_size[2];
+
+  // move voxel box one step outside the slab
+  Eigen::Translation3d box_start_position((x_begin - 0.5) * x_voxel_dimension, -0.5 * y_voxel_dimension,
+                                          -0.5 * z_voxel_dimension);
+  voxel_world.getWorld()->moveShapeInObject(VOXEL_BOX_ID, box, world_to_volume * box_start_position);
 
   // x/y/z translation steps, since relative movements are more efficient than repositioning the object
   auto volume_orientation = world_to_volume.rotation();
-  auto x_step(volume_orientation * decltype(world_to_volume)(Eigen::Translation3d(x_voxel_dimension, 0, 0)));
-  auto y_step(volume_orientation * decltype(world_to_volume)(Eigen::Translation3d(0, y_voxel_dimension, 0)));
-  auto z_step(volume_orientation * decltype(world_to_volume)(Eigen::Translation3d(0, 0, z_voxel_dimension)));
+  auto x_step(volume_orientation * WorldTransform(Eigen::Translation3d(x_voxel_dimension, 0, 0)));
+  auto y_step(volume_orientation * WorldTransform(Eigen::Translation3d(0, y_voxel_dimension, 0)));
+  auto z_step(volume_orientation * WorldTransform(Eigen::Translation3d(0, 0, z_voxel_dimension)));
 
   // x/y reset transforms
-  auto y_reset(volume_orientation *
-               decltype(world_to_volume)(Eigen::Translation3d(0, -y_voxels * y_voxel_dimension, 0)));
-  auto z_reset(volume_orientation *
-               decltype(world_to_volume)(Eigen::Translation3d(0, 0, -z_voxels * z_voxel_dimension)));
+  auto y_reset(volume_orientation * WorldTransform(Eigen::Translation3d(0, -y_voxels * y_voxel_dimension, 0)));
+  auto z_reset(volume_orientation * WorldTransform(Eigen::Translation3d(0, 0, -z_voxels * z_voxel_dimension)));
 
   // Loop over X/Y/Z voxel positions and check for box collisions in the collision scene
-  // NOTE: This implementation is a prototype and will be replaced by more efficient methods as described below
-  // TODO(RTR-57): More efficient implementations:
-  //                          * Iterate over collision objects and only sample local bounding boxes
-  //                          * Use octree search, since boxes can have variable sizes
+  // NOTE: This implementation is a prototype, see voxelizeCollisionObject() and checkVoxelRegionCollisions() for more
+  // efficient methods
   // TODO(RTR-57): adjust grid to odd volume dimensions
   // TODO(RTR-57): Do we need extra Box padding here?
   collision_detection::CollisionRequest request;
   collision_detection::CollisionResult result;
-  for (uint16_t x = 0; x < x_voxels; ++x)
+  for (uint16_t x = x_begin; x < x_end; ++x)
   {
-    world.getWorld()->moveObject(box_id, x_step);
+    voxel_world.getWorld()->moveObject(VOXEL_BOX_ID, x_step);
     for (uint16_t y = 0; y < y_voxels; ++y)
     {
-      world.getWorld()->moveObject(box_id, y_step);
+      voxel_world.getWorld()->moveObject(VOXEL_BOX_ID, y_step);
       for (uint16_t z = 0; z < z_voxels; ++z)
       {
-        world.getWorld()->moveObject(box_id, z_step);
-        planning_scene->getCollisionWorld()->checkWorldCollision(request, result, world);
+        voxel_world.getWorld()->moveObject(VOXEL_BOX_ID, z_step);
+        collision_world.checkWorldCollision(request, result, voxel_world);
         if (result.collision)
         {
-          occupancy_data.voxels.push_back(rtr::Voxel(x, y, z));
+          voxels.push_back(rtr::Voxel(x, y, z));
           result.clear();  // TODO(RTR-57): Is this really necessary?
         }
       }
       // move object back to z start
-      world.getWorld()->moveObject(box_id, z_reset);
+      voxel_world.getWorld()->moveObject(VOXEL_BOX_ID, z_reset);
     }
     // move object back to y start
-    world.getWorld()->moveObject(box_id, y_reset);
+    voxel_world.getWorld()->moveObject(VOXEL_BOX_ID, y_reset);
   }
+}
+
+/** Generates occupancy voxels by checking each voxel box in the volume region for collisions with the world.
+ *  With multiple threads, the volume is split into x-slabs that are checked in parallel. Each thread uses its own
+ *  voxel box collision world and the slab results are merged in x order so that the voxel order does not change.
+ * @param collision_world - the collision world to check
+ * @param volume - the volume region
+ * @param world_to_volume - the world pose of the volume origin corner
+ * @param num_threads - the number of threads to use
+ * @param voxels - the occupancy voxels result
+ */
+void checkVoxelCollisions(const collision_detection::CollisionWorld& collision_world, const RoadmapVolume& volume,
+                          const WorldTransform& world_to_volume, std::size_t num_threads,
+                          std::vector<rtr::Voxel>& voxels)
+{
+  // TODO(henningkayser): Check that box id is not present in planning scene - should be unique
+  shapes::ShapeConstPtr box = createVoxelBox(volume);
+  uint16_t x_voxels = volume.voxel_resolution[0];
+  num_threads = std::min<std::size_t>(num_threads, x_voxels);
+  if (num_threads <= 1)
+  {
+    collision_detection::CollisionWorldFCL voxel_world;
+    voxel_world.getWorld()->addToObject(VOXEL_BOX_ID, box, world_to_volume);
+    checkVoxelSlabCollisions(collision_world, volume, world_to_volume, voxel_world, 0, x_voxels, voxels);
+    return;
+  }
+
+  // slabs are one voxel thick and are assigned to the next free thread for balancing cluttered regions
+  std::vector<std::vector<rtr::Voxel>> slab_voxels(x_voxels);
+  std::atomic<uint16_t> next_slab(0);
+  auto check_slabs = [&]() {
+    collision_detection::CollisionWorldFCL voxel_world;
+    voxel_world.getWorld()->addToObject(VOXEL_BOX_ID, box, world_to_volume);
+    for (uint16_t x = next_slab++; x < x_voxels; x = next_slab++)
+      checkVoxelSlabCollisions(collision_world, volume, world_to_volume, voxel_world, x, x + 1, slab_voxels[x]);
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < num_threads; ++i)
+    threads.emplace_back(check_slabs);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // merge slabs in x order
+  for (const std::vector<rtr::Voxel>& slab : slab_voxels)
+    voxels.insert(voxels.end(), slab.begin(), slab.end());
+}
+}  // namespace
+
+OccupancyHandler::OccupancyHandler(const ros::NodeHandle& nh)
+  : nh_(nh), tf_listener_(tf_buffer_), pcl_shared_slot_(2)
+{
+}
+
+void OccupancyHandler::setVolumeRegion(const RoadmapVolume& roadmap_volume)
+{
+  std::lock_guard<std::mutex> lock(occupancy_mtx_);
+  volume_region_ = roadmap_volume;
+}
+
+void OccupancyHandler::setPointCloudTopic(const std::string& pcl_topic)
+{
+  std::lock_guard<std::mutex> lock(pcl_mtx_);
+  subscribePointCloud(pcl_topic);
+}
+
+void OccupancyHandler::setPointCloudMaxAge(double max_age)
+{
+  std::lock_guard<std::mutex> lock(pcl_mtx_);
+  pcl_max_age_ = max_age;
+}
+
+void OccupancyHandler::setPointCloudVoxelization(bool enabled)
+{
+  std::lock_guard<std::mutex> lock(pcl_mtx_);
+  pcl_voxelization_ = enabled;
+}
+
+void OccupancyHandler::setVoxelizationMethod(VoxelizationMethod method)
+{
+  std::lock_guard<std::mutex> lock(occupancy_mtx_);
+  voxelization_method_ = method;
+}
+
+void OccupancyHandler::setVoxelizationThreads(std::size_t num_threads)
+{
+  std::lock_guard<std::mutex> lock(occupancy_mtx_);
+  voxelization_threads_ = num_threads > 0 ? num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void OccupancyHandler::setOccupancyCacheSize(std::size_t cache_size)
+{
+  std::lock_guard<std::mutex> lock(occupancy_mtx_);
+  occupancy_cache_size_ = cache_size;
+  if (occupancy_cache_.size() > occupancy_cache_size_)
+    occupancy_cache_.resize(occupancy_cache_size_);
+}
+
+bool OccupancyHandler::fromPointCloud(const std::string& pcl_topic, OccupancyData& occupancy_data, int timeout)
+{
+  // copy the volume region since it may be modified by concurrent queries
+  RoadmapVolume volume_region;
+  {  // SCOPED MUTEX LOCK
+    std::lock_guard<std::mutex> lock(occupancy_mtx_);
+    volume_region = volume_region_;
+  }  // SCOPED MUTEX UNLOCK
+
+  std::lock_guard<std::mutex> lock(pcl_mtx_);
+  subscribePointCloud(pcl_topic);
+
+  // use the latest point cloud, only wait for a new one if it's too old
+  // TODO(RTR-59): Use planning time to determine timeouts
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud;
+  ros::Time stamp;
+  while (true)
+  {
+    cloud = getLatestPointCloud();
+    if (cloud)
+    {
+      // pcl stamps are given in microseconds
+      pcl_conversions::fromPCL(cloud->header.stamp, stamp);
+      if ((ros::Time::now() - stamp).toSec() <= pcl_max_age_)
+        break;
+    }
+    if (std::chrono::steady_clock::now() > deadline)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Waiting for point cloud data timed out");
+      return false;
+    }
+
+    // wait until the subscriber publishes a new point cloud
+    std::unique_lock<std::mutex> notify_lock(pcl_notify_mtx_);
+    pcl_cv_.wait_until(notify_lock, deadline, [this]() { return pcl_shared_slot_.load() & PCL_FRESH_FLAG; });
+  }
+
+  // get transform from point cloud frame to volume frame
+  const std::string& volume_frame = volume_region.pose.header.frame_id;
+  Eigen::Affine3f cloud_to_volume = Eigen::Affine3f::Identity();
+  if (cloud->header.frame_id != volume_frame)
+  {
+    double remaining_time = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+    if (!getPointCloudTransform(cloud->header.frame_id, volume_frame, stamp, std::max(remaining_time, 0.0),
+                                cloud_to_volume))
+      return false;
+  }
+
+  // bin points into voxels of the volume region
+  if (pcl_voxelization_)
+  {
+    Eigen::Affine3d volume_pose;
+    tf::poseMsgToEigen(volume_region.pose.pose, volume_pose);
+    occupancy_data.type = OccupancyData::Type::VOXELS;
+    occupancy_data.voxels.resize(0);
+    voxelizePointCloud(*cloud, volume_pose.inverse().cast<float>() * cloud_to_volume, volume_region,
+                       occupancy_data.voxels);
+    return true;
+  }
+
+  // transform point cloud into volume frame, the buffered cloud is left untouched since it may be reused
+  if (cloud->header.frame_id != volume_frame)
+  {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr volume_cloud(new pcl::PointCloud<pcl::PointXYZ>());
+    pcl::transformPointCloud(*cloud, *volume_cloud, cloud_to_volume);
+    volume_cloud->header.frame_id = volume_frame;
+    cloud = volume_cloud;
+  }
+
+  // get result
+  occupancy_data.type = OccupancyData::Type::POINT_CLOUD;
+  occupancy_data.point_cloud = cloud;
   return true;
 }
+
+bool OccupancyHandler::getPointCloudTransform(const std::string& cloud_frame, const std::string& volume_frame,
+                                              const ros::Time& stamp, double timeout, Eigen::Affine3f& cloud_to_volume)
+{
+  try
+  {
+    // transforms that only consist of static frames are stamped with time 0 and valid for all point cloud stamps
+    // the lookup is repeated for each query so that republished static transforms are applied
+    geometry_msgs::TransformStamped transform;
+    if (tf_buffer_.canTransform(volume_frame, cloud_frame, ros::Time(0)))
+    {
+      transform = tf_buffer_.lookupTransform(volume_frame, cloud_frame, ros::Time(0));
+      if (transform.header.stamp.isZero())
+      {
+        cloud_to_volume = tf2::transformToEigen(transform).cast<float>();
+        return true;
+      }
+    }
+
+    // dynamic transforms are looked up at the time the point cloud was sensed
+    transform = tf_buffer_.lookupTransform(volume_frame, cloud_frame, stamp, ros::Duration(timeout));
+    cloud_to_volume = tf2::transformToEigen(transform).cast<float>();
+  }
+  catch (const tf2::TransformException& ex)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to transform point cloud into volume region frame: " << ex.what());
+    return false;
+  }
+  return true;
+}
+
+void OccupancyHandler::subscribePointCloud(const std::string& pcl_topic)
+{
+  if (pcl_sub_ && pcl_topic == pcl_topic_)
+    return;
+  pcl_topic_ = pcl_topic;
+  pcl_sub_ = nh_.subscribe(pcl_topic_, 1, &OccupancyHandler::pclCallback, this);
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr OccupancyHandler::getLatestPointCloud()
+{
+  // swap read slot with the shared slot if the writer has published a new point cloud
+  if (pcl_shared_slot_.load() & PCL_FRESH_FLAG)
+    pcl_read_slot_ = pcl_shared_slot_.exchange(pcl_read_slot_) & ~PCL_FRESH_FLAG;
+  return pcl_buffers_[pcl_read_slot_];
+}
+
+void OccupancyHandler::pclCallback(const pcl::PCLPointCloud2ConstPtr& cloud_pcl2)
+{
+  // callbacks of a subscriber are not called concurrently so the write slot is owned by this function
+  // allocate a new point cloud if the current one is still referenced by previous query results
+  pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud = pcl_buffers_[pcl_write_slot_];
+  if (!cloud || cloud.use_count() > 1)
+    cloud.reset(new pcl::PointCloud<pcl::PointXYZ>());
+  pcl::fromPCLPointCloud2(*cloud_pcl2, *cloud);
+
+  // publish the new point cloud and continue writing into the previously shared slot
+  // the slot is exchanged under the notify lock so that waiting queries can't miss the notification
+  {  // SCOPED MUTEX LOCK
+    std::lock_guard<std::mutex> lock(pcl_notify_mtx_);
+    pcl_write_slot_ = pcl_shared_slot_.exchange(pcl_write_slot_ | PCL_FRESH_FLAG) & ~PCL_FRESH_FLAG;
+  }  // SCOPED MUTEX UNLOCK
+  pcl_cv_.notify_all();
+}
+
+bool OccupancyHandler::fromPlanningScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                         OccupancyData& occupancy_data)
+{
+  std::lock_guard<std::mutex> lock(occupancy_mtx_);
+
+  // Compute transform: world->volume
+  // world_to_volume points at the corner of the volume origin (x=0,y=0,z=0)
+  // we use auto to support Affine3d and Isometry3d (kinetic + melodic)
+  auto world_to_base(planning_scene->getFrameTransform(volume_region_.pose.header.frame_id));
+  auto base_to_volume = world_to_base;
+  tf::poseMsgToEigen(volume_region_.pose.pose, base_to_volume);
+  auto world_to_volume = world_to_base * base_to_volume;
+
+  // clear scene boxes vector
+  occupancy_data.type = OccupancyData::Type::VOXELS;
+  occupancy_data.voxels.resize(0);
+
+  // reuse cached voxels of a previous query with the same scene content
+  OccupancyQueryKey query_key;
+  bool cacheable =
+      occupancy_cache_size_ > 0 && getOccupancyQueryKey(*planning_scene->getWorld(), world_to_volume, query_key);
+  if (cacheable)
+  {
+    auto cached = std::find_if(occupancy_cache_.begin(), occupancy_cache_.end(),
+                               [&](const CachedVoxels& entry) { return entry.key == query_key; });
+    if (cached != occupancy_cache_.end())
+    {
+      ++cache_hits_;
+      ROS_DEBUG_NAMED(LOGNAME, "Reusing cached occupancy voxels (hits: %zu, misses: %zu)", cache_hits_, cache_misses_);
+      occupancy_cache_.splice(occupancy_cache_.begin(), occupancy_cache_, cached);
+      occupancy_data.voxels = cached->voxels;
+      return true;
+    }
+    ++cache_misses_;
+  }
+
+  if (voxelization_method_ == ANALYTIC)
+  {
+    voxelizeWorldObjects(*planning_scene->getWorld(), world_to_volume, occupancy_data.voxels);
+  }
+  else if (voxelization_method_ == HIERARCHICAL)
+  {
+    VoxelBounds region;
+    region.min = { { 0, 0, 0 } };
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+      if (volume_region_.voxel_resolution[axis] == 0)
+        return true;
+      region.max[axis] = volume_region_.voxel_resolution[axis] - 1;
+    }
+    collision_detection::CollisionWorldFCL region_world;
+    OccupancyGrid occupied(volume_region_.voxel_resolution);
+    checkVoxelRegionCollisions(*planning_scene->getCollisionWorld(), region_world, volume_region_, world_to_volume,
+                               region, occupied);
+    occupied.toVoxels(occupancy_data.voxels);
+  }
+  else
+    checkVoxelCollisions(*planning_scene->getCollisionWorld(), volume_region_, world_to_volume, voxelization_threads_,
+                         occupancy_data.voxels);
+
+  // cache voxels, the least recently used entry is dropped
+  if (cacheable)
+  {
+    occupancy_cache_.push_front(CachedVoxels());
+    occupancy_cache_.front().key = std::move(query_key);
+    occupancy_cache_.front().voxels = occupancy_data.voxels;
+    if (occupancy_cache_.size() > occupancy_cache_size_)
+      occupancy_cache_.pop_back();
+  }
+  return true;
+}
+
+std::size_t OccupancyHandler::getCacheHits()
+{
+  std::lock_guard<std::mutex> lock(occupancy_mtx_);
+  return cache_hits_;
+}
+
+std::size_t OccupancyHandler::getCacheMisses()
+{
+  std::lock_guard<std::mutex> lock(occupancy_mtx_);
+  return cache_misses_;
+}
+
+bool OccupancyHandler::OccupancyQueryKey::operator==(const OccupancyQueryKey& other) const
+{
+  if (hash != other.hash || object_ids != other.object_ids || parameters != other.parameters ||
+      meshes.size() != other.meshes.size())
+    return false;
+  for (std::size_t i = 0; i < meshes.size(); ++i)
+  {
+    if (meshes[i] != other.meshes[i] &&
+        !equalMeshes(static_cast<const shapes::Mesh&>(*meshes[i]), static_cast<const shapes::Mesh&>(*other.meshes[i])))
+      return false;
+  }
+  return true;
+}
+
+bool OccupancyHandler::getOccupancyQueryKey(const collision_detection::World& world,
+                                            const WorldTransform& world_to_volume, OccupancyQueryKey& key) const
+{
+  // voxelization method and volume region
+  std::vector<double>& parameters = key.parameters;
+  parameters.push_back(voxelization_method_);
+  parameters.insert(parameters.end(), volume_region_.dimension.begin(), volume_region_.dimension.end());
+  parameters.insert(parameters.end(), volume_region_.voxel_resolution.begin(), volume_region_.voxel_resolution.end());
+  parameters.insert(parameters.end(), world_to_volume.matrix().data(), world_to_volume.matrix().data() + 16);
+
+  // collision objects
+  for (const auto& object : world)
+  {
+    key.object_ids.push_back(object.first);
+    parameters.push_back(object.second->shapes_.size());
+    for (std::size_t i = 0; i < object.second->shapes_.size(); ++i)
+    {
+      const shapes::ShapeConstPtr& shape = object.second->shapes_[i];
+      if (!appendShapeParameters(*shape, parameters))
+        return false;
+      if (shape->type == shapes::MESH)
+        key.meshes.push_back(shape);
+      const auto& shape_pose = object.second->shape_poses_[i].matrix();
+      parameters.insert(parameters.end(), shape_pose.data(), shape_pose.data() + 16);
+    }
+  }
+
+  // the hash speeds up comparisons with cached keys
+  key.hash = 0;
+  for (const std::string& object_id : key.object_ids)
+    hashCombine(key.hash, object_id);
+  hashCombine(key.hash, parameters.data(), parameters.size());
+  for (const shapes::ShapeConstPtr& shape : key.meshes)
+  {
+    const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(*shape);
+    hashCombine(key.hash, mesh.vertices, 3 * mesh.vertex_count);
+    hashCombine(key.hash, mesh.triangles, 3 * mesh.triangle_count);
+  }
+  return true;
+}
+
+void OccupancyHandler::voxelizeWorldObjects(const collision_detection::World& world,
+                                            const WorldTransform& world_to_volume, std::vector<rtr::Voxel>& voxels)
+{
+  // reset all object voxels if the volume region has changed
+  const std::size_t voxel_count = getVoxelCount(volume_region_);
+  if (voxel_object_counts_.size() != voxel_count || world_voxels_volume_pose_ != world_to_volume.matrix() ||
+      world_voxels_volume_.dimension != volume_region_.dimension ||
+      world_voxels_volume_.voxel_resolution != volume_region_.voxel_resolution)
+  {
+    object_voxels_.clear();
+    world_voxels_.clear();
+    voxel_object_counts_.assign(voxel_count, 0);
+    world_voxels_volume_pose_ = world_to_volume.matrix();
+    world_voxels_volume_ = volume_region_;
+  }
+
+  // remove voxels of objects that have been removed or modified
+  bool voxels_changed = false;
+  for (auto object_voxels = object_voxels_.begin(); object_voxels != object_voxels_.end();)
+  {
+    if (world.getObject(object_voxels->first) != object_voxels->second.object)
+    {
+      for (std::size_t index : object_voxels->second.voxel_indices)
+        --voxel_object_counts_[index];
+      voxels_changed |= !object_voxels->second.voxel_indices.empty();
+      object_voxels = object_voxels_.erase(object_voxels);
+    }
+    else
+      ++object_voxels;
+  }
+
+  // rasterize added or modified objects
+  for (const auto& object : world)
+  {
+    if (object_voxels_.count(object.first))
+      continue;
+    ObjectVoxels& object_voxels = object_voxels_[object.first];
+    object_voxels.object = object.second;
+    voxelizeCollisionObject(*object.second, volume_region_, world_to_volume, object_voxels.voxel_indices);
+    for (std::size_t index : object_voxels.voxel_indices)
+      ++voxel_object_counts_[index];
+    voxels_changed |= !object_voxels.voxel_indices.empty();
+  }
+
+  // update voxels if objects have changed
+  if (voxels_changed)
+  {
+    world_voxels_.clear();
+    appendOccupiedVoxels(voxel_object_counts_, volume_region_, world_voxels_);
+  }
+  voxels.insert(voxels.end(), world_voxels_.begin(), world_voxels_.end());
+}
 }  // namespace rtr_moveit
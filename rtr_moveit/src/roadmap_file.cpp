@@ -0,0 +1,485 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Loading of roadmap data from *.og files and from memory-mapped binary sidecar files
+ */
+
+#include <rtr_moveit/roadmap_file.h>
+
+// C++
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+// POSIX file mapping
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ROS
+#include <ros/ros.h>
+#include <tf/transform_datatypes.h>
+
+// RapidPlan
+#include <rtr-api/OGFileReader.hpp>
+
+namespace rtr_moveit
+{
+namespace
+{
+const std::string LOGNAME = "roadmap_file";
+
+// "RTRMAP" followed by a line break sequence, so that text mode transfers are detected
+const char SIDECAR_MAGIC[8] = { 'R', 'T', 'R', 'M', 'A', 'P', '\r', '\n' };
+const std::uint32_t SIDECAR_BYTE_ORDER = 0x01020304;
+const std::uint64_t SIDECAR_ALIGNMENT = 8;
+
+/** Header at the beginning of a sidecar file, all sections are aligned to 8 bytes and stored in native byte order.
+ *  The file layout is: header | configs (float) | poses (rtr::ToolPose) | edges (rtr::EdgeInfo) | frame names */
+struct SidecarHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint64_t file_size;
+  std::uint64_t data_checksum;  // checksum of everything behind the header
+
+  // roadmap file the sidecar was generated from
+  std::uint64_t source_size;
+  std::int64_t source_modification_time;
+  std::uint64_t source_checksum;
+
+  // element counts and sizes, element sizes must match so that sections can be read in place
+  std::uint64_t num_configs;
+  std::uint64_t num_poses;
+  std::uint64_t num_edges;
+  std::uint32_t dimension;
+  std::uint32_t pose_size;
+  std::uint32_t edge_size;
+  std::uint32_t base_link_frame_size;
+  std::uint32_t end_effector_frame_size;
+  std::uint16_t voxel_resolution[3];
+  std::uint16_t padding;
+
+  // volume region
+  double volume_position[3];
+  double volume_orientation[4];  // quaternion x, y, z, w
+  float volume_dimension[3];
+  std::uint32_t padding2;
+
+  // section offsets
+  std::uint64_t configs_offset;
+  std::uint64_t poses_offset;
+  std::uint64_t edges_offset;
+  std::uint64_t frames_offset;
+};
+static_assert(sizeof(SidecarHeader) % SIDECAR_ALIGNMENT == 0, "Sidecar header breaks section alignment");
+static_assert(std::is_trivially_copyable<rtr::ToolPose>::value, "Sidecar poses must be trivially copyable");
+static_assert(std::is_trivially_copyable<rtr::EdgeInfo>::value, "Sidecar edges must be trivially copyable");
+
+/** Read-only memory mapping of a file, the mapping is released on destruction */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string& file)
+  {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+      void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+      {
+        data_ = static_cast<const char*>(data);
+        size_ = file_stat.st_size;
+        madvise(data, size_, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+  }
+
+  ~MappedFile()
+  {
+    if (data_)
+      munmap(const_cast<char*>(data_), size_);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const
+  {
+    return data_;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+/** Computes a 64 bit FNV-1a style checksum, words of 8 bytes are hashed at once for speed */
+std::uint64_t computeChecksum(const char* data, std::size_t size)
+{
+  const std::uint64_t prime = 1099511628211ULL;
+  std::uint64_t hash = 14695981039346656037ULL;
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    std::uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 32;  // mix high bits back since the multiplication only carries upwards
+  }
+  for (; i < size; ++i)
+    hash = (hash ^ std::uint8_t(data[i])) * prime;
+  return hash;
+}
+
+/** Returns true if a section with count elements of element_size bytes at offset lies inside the file behind the
+ *  previous section. Sections are stored in ascending order behind the header without overlaps.
+ * @param section_begin - the minimum offset of the section, set to the end of the section if it is valid
+ */
+bool isValidSection(std::uint64_t offset, std::uint64_t count, std::uint64_t element_size, std::uint64_t file_size,
+                    std::uint64_t& section_begin)
+{
+  if (offset % SIDECAR_ALIGNMENT != 0 || offset < section_begin || offset > file_size ||
+      (element_size != 0 && count > (file_size - offset) / element_size))
+    return false;
+  section_begin = offset + count * element_size;
+  return true;
+}
+
+std::uint64_t alignSection(std::uint64_t offset)
+{
+  return (offset + SIDECAR_ALIGNMENT - 1) / SIDECAR_ALIGNMENT * SIDECAR_ALIGNMENT;
+}
+}  // namespace
+
+std::string getRoadmapSidecarFile(const std::string& og_file)
+{
+  std::size_t extension = og_file.rfind(".og");
+  if (extension != std::string::npos && extension + 3 == og_file.size())
+    return og_file.substr(0, extension) + ".ogmap";
+  return og_file + ".ogmap";
+}
+
+bool loadRoadmapFile(const std::string& og_file, RoadmapData& roadmap)
+{
+  struct stat og_stat;
+  if (stat(og_file.c_str(), &og_stat) != 0)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to access roadmap file '" << og_file << "'");
+    return false;
+  }
+  roadmap.og_file = og_file;
+  roadmap.modification_time = og_stat.st_mtime;
+
+  rtr::OGFileReader og_file_reader(og_file);
+  if (!og_file_reader.IsValid())
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file invalid " << og_file << "'");
+    return false;
+  }
+
+  // get roadmap configs
+  std::shared_ptr<std::vector<rtr::Config>> configs = std::make_shared<std::vector<rtr::Config>>();
+  if (!og_file_reader.GetConfigs(*configs) || configs->empty())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load config states from roadmap file");
+    return false;
+  }
+  roadmap.configs = configs;
+
+  // get roadmap poses
+  if (!og_file_reader.GetPoses(roadmap.poses) || roadmap.poses.empty())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load state poses from roadmap file");
+    return false;
+  }
+
+  // get roadmap edges
+  if (!og_file_reader.GetEdges(roadmap.edges) || roadmap.edges.empty())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load state edges from roadmap file");
+    return false;
+  }
+
+  // load occupancy region volume
+  rtr::ToolPose volume_center_pose;
+  if (!og_file_reader.GetVoxelRegion(roadmap.volume.pose.header.frame_id, volume_center_pose,
+                                     roadmap.volume.dimension))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load voxel region from roadmap file");
+    return false;
+  }
+  roadmap.volume.pose.pose.position.x = volume_center_pose[0];
+  roadmap.volume.pose.pose.position.y = volume_center_pose[1];
+  roadmap.volume.pose.pose.position.z = volume_center_pose[2];
+  roadmap.volume.pose.pose.orientation =
+      tf::createQuaternionMsgFromRollPitchYaw(volume_center_pose[3], volume_center_pose[4], volume_center_pose[5]);
+  roadmap.volume.pose.header.frame_id = "world";  // NOTE: GetVoxelRegion returns an empty frame - we fix this here
+  if (!og_file_reader.GetResolution(roadmap.volume.voxel_resolution))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Failed to read volume voxel resolution from roadmap file");
+    return false;
+  }
+  std::array<float, 6> start_link_transform;
+  if (!og_file_reader.GetKinematicData(start_link_transform, roadmap.base_link_frame, roadmap.end_effector_frame))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Failed to read kinematic data roadmap file");
+    return false;
+  }
+  return true;
+}
+
+bool loadRoadmapSidecar(const std::string& sidecar_file, const std::string& og_file, RoadmapData& roadmap)
+{
+  MappedFile sidecar(sidecar_file);
+  if (!sidecar.data())
+  {
+    ROS_DEBUG_STREAM_NAMED(LOGNAME, "No roadmap sidecar found at: " << sidecar_file);
+    return false;
+  }
+
+  // check format
+  SidecarHeader header;
+  if (sidecar.size() < sizeof(header))
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Ignoring corrupted roadmap sidecar '" << sidecar_file << "'");
+    return false;
+  }
+  std::memcpy(&header, sidecar.data(), sizeof(header));
+  if (std::memcmp(header.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC)) != 0 || header.file_size != sidecar.size())
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Ignoring corrupted roadmap sidecar '" << sidecar_file << "'");
+    return false;
+  }
+  if (header.version != ROADMAP_SIDECAR_VERSION || header.byte_order != SIDECAR_BYTE_ORDER ||
+      header.pose_size != sizeof(rtr::ToolPose) || header.edge_size != sizeof(rtr::EdgeInfo))
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Ignoring roadmap sidecar '" << sidecar_file << "' of incompatible format, please "
+                                                                   "regenerate it");
+    return false;
+  }
+  // the header is not covered by the data checksum, so section offsets must not point into the header
+  std::uint64_t section_begin = sizeof(header);
+  if (header.num_configs == 0 || header.dimension == 0 ||
+      !isValidSection(header.configs_offset, header.num_configs, sizeof(float) * header.dimension, header.file_size,
+                      section_begin) ||
+      !isValidSection(header.poses_offset, header.num_poses, sizeof(rtr::ToolPose), header.file_size,
+                      section_begin) ||
+      !isValidSection(header.edges_offset, header.num_edges, sizeof(rtr::EdgeInfo), header.file_size,
+                      section_begin) ||
+      !isValidSection(header.frames_offset, std::uint64_t(header.base_link_frame_size) + header.end_effector_frame_size,
+                      1, header.file_size, section_begin))
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Ignoring corrupted roadmap sidecar '" << sidecar_file << "'");
+    return false;
+  }
+
+  // check if the sidecar was generated from the current roadmap file, the roadmap file is only read if size and
+  // modification time are inconclusive
+  struct stat og_stat;
+  if (stat(og_file.c_str(), &og_stat) != 0)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to access roadmap file '" << og_file << "'");
+    return false;
+  }
+  bool is_stale = header.source_size != std::uint64_t(og_stat.st_size);
+  if (!is_stale && header.source_modification_time != std::int64_t(og_stat.st_mtime))
+  {
+    MappedFile source(og_file);
+    is_stale = !source.data() || computeChecksum(source.data(), source.size()) != header.source_checksum;
+  }
+  if (is_stale)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Ignoring stale roadmap sidecar '" << sidecar_file << "', please regenerate it");
+    return false;
+  }
+
+  // check data integrity
+  const char* data = sidecar.data();
+  if (computeChecksum(data + sizeof(header), header.file_size - sizeof(header)) != header.data_checksum)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Ignoring corrupted roadmap sidecar '" << sidecar_file << "'");
+    return false;
+  }
+
+  // read sections
+  roadmap.og_file = og_file;
+  roadmap.modification_time = og_stat.st_mtime;
+  std::shared_ptr<std::vector<rtr::Config>> configs = std::make_shared<std::vector<rtr::Config>>();
+  configs->reserve(header.num_configs);
+  const float* config_values = reinterpret_cast<const float*>(data + header.configs_offset);
+  for (std::size_t i = 0; i < header.num_configs; ++i)
+    configs->emplace_back(config_values + i * header.dimension, config_values + (i + 1) * header.dimension);
+  roadmap.configs = configs;
+  const rtr::ToolPose* poses = reinterpret_cast<const rtr::ToolPose*>(data + header.poses_offset);
+  roadmap.poses.assign(poses, poses + header.num_poses);
+  const rtr::EdgeInfo* edges = reinterpret_cast<const rtr::EdgeInfo*>(data + header.edges_offset);
+  roadmap.edges.assign(edges, edges + header.num_edges);
+  const char* frames = data + header.frames_offset;
+  roadmap.base_link_frame.assign(frames, header.base_link_frame_size);
+  roadmap.end_effector_frame.assign(frames + header.base_link_frame_size, header.end_effector_frame_size);
+
+  // read volume region
+  roadmap.volume.pose.header.frame_id = "world";
+  roadmap.volume.pose.pose.position.x = header.volume_position[0];
+  roadmap.volume.pose.pose.position.y = header.volume_position[1];
+  roadmap.volume.pose.pose.position.z = header.volume_position[2];
+  roadmap.volume.pose.pose.orientation.x = header.volume_orientation[0];
+  roadmap.volume.pose.pose.orientation.y = header.volume_orientation[1];
+  roadmap.volume.pose.pose.orientation.z = header.volume_orientation[2];
+  roadmap.volume.pose.pose.orientation.w = header.volume_orientation[3];
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    roadmap.volume.dimension[i] = header.volume_dimension[i];
+    roadmap.volume.voxel_resolution[i] = header.voxel_resolution[i];
+  }
+  return true;
+}
+
+bool writeRoadmapSidecar(const RoadmapData& roadmap, const std::string& sidecar_file)
+{
+  if (!roadmap.configs || roadmap.configs->empty())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Cannot write roadmap sidecar without configs");
+    return false;
+  }
+  const std::size_t dimension = roadmap.configs->front().size();
+  for (const rtr::Config& config : *roadmap.configs)
+  {
+    if (config.size() != dimension)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Cannot write roadmap sidecar of configs with varying dimensions");
+      return false;
+    }
+  }
+
+  // the roadmap file must not have changed since the data was loaded, otherwise the checksum doesn't match the data
+  MappedFile source(roadmap.og_file);
+  struct stat og_stat;
+  if (!source.data() || stat(roadmap.og_file.c_str(), &og_stat) != 0 ||
+      og_stat.st_mtime != roadmap.modification_time)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file '" << roadmap.og_file << "' is missing or has changed since loading");
+    return false;
+  }
+
+  // compute file layout
+  SidecarHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+  header.version = ROADMAP_SIDECAR_VERSION;
+  header.byte_order = SIDECAR_BYTE_ORDER;
+  header.source_size = source.size();
+  header.source_modification_time = og_stat.st_mtime;
+  header.source_checksum = computeChecksum(source.data(), source.size());
+  header.num_configs = roadmap.configs->size();
+  header.num_poses = roadmap.poses.size();
+  header.num_edges = roadmap.edges.size();
+  header.dimension = dimension;
+  header.pose_size = sizeof(rtr::ToolPose);
+  header.edge_size = sizeof(rtr::EdgeInfo);
+  header.base_link_frame_size = roadmap.base_link_frame.size();
+  header.end_effector_frame_size = roadmap.end_effector_frame.size();
+  header.configs_offset = sizeof(header);
+  header.poses_offset = alignSection(header.configs_offset + header.num_configs * dimension * sizeof(float));
+  header.edges_offset = alignSection(header.poses_offset + header.num_poses * sizeof(rtr::ToolPose));
+  header.frames_offset = alignSection(header.edges_offset + header.num_edges * sizeof(rtr::EdgeInfo));
+  header.file_size = header.frames_offset + header.base_link_frame_size + header.end_effector_frame_size;
+
+  // volume region
+  const geometry_msgs::Pose& volume_pose = roadmap.volume.pose.pose;
+  header.volume_position[0] = volume_pose.position.x;
+  header.volume_position[1] = volume_pose.position.y;
+  header.volume_position[2] = volume_pose.position.z;
+  header.volume_orientation[0] = volume_pose.orientation.x;
+  header.volume_orientation[1] = volume_pose.orientation.y;
+  header.volume_orientation[2] = volume_pose.orientation.z;
+  header.volume_orientation[3] = volume_pose.orientation.w;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    header.volume_dimension[i] = roadmap.volume.dimension[i];
+    header.voxel_resolution[i] = roadmap.volume.voxel_resolution[i];
+  }
+
+  // fill sections
+  std::vector<char> buffer(header.file_size, 0);
+  float* config_values = reinterpret_cast<float*>(&buffer[header.configs_offset]);
+  for (const rtr::Config& config : *roadmap.configs)
+    config_values = std::copy(config.begin(), config.end(), config_values);
+  if (!roadmap.poses.empty())
+    std::memcpy(&buffer[header.poses_offset], roadmap.poses.data(), header.num_poses * sizeof(rtr::ToolPose));
+  if (!roadmap.edges.empty())
+    std::memcpy(&buffer[header.edges_offset], roadmap.edges.data(), header.num_edges * sizeof(rtr::EdgeInfo));
+  std::copy(roadmap.base_link_frame.begin(), roadmap.base_link_frame.end(), &buffer[header.frames_offset]);
+  std::copy(roadmap.end_effector_frame.begin(), roadmap.end_effector_frame.end(),
+            &buffer[header.frames_offset + header.base_link_frame_size]);
+  header.data_checksum = computeChecksum(&buffer[sizeof(header)], buffer.size() - sizeof(header));
+  std::memcpy(&buffer[0], &header, sizeof(header));
+
+  // write to a temporary file first so that running planners never map partially written sidecars
+  const std::string tmp_file = sidecar_file + ".tmp";
+  {
+    std::ofstream stream(tmp_file, std::ios::binary | std::ios::trunc);
+    stream.write(buffer.data(), buffer.size());
+    if (!stream.good())
+    {
+      ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to write roadmap sidecar '" << tmp_file << "'");
+      std::remove(tmp_file.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmp_file.c_str(), sidecar_file.c_str()) != 0)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to replace roadmap sidecar '" << sidecar_file << "'");
+    std::remove(tmp_file.c_str());
+    return false;
+  }
+  return true;
+}
+}  // namespace rtr_moveit
@@ -0,0 +1,953 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Search indices for roadmap configs and tool poses
+ */
+
+// C++
+#include <atomic>
+#include <thread>
+
+// rtr_moveit
+#include <rtr_moveit/roadmap_search.h>
+
+namespace rtr_moveit
+{
+ConfigStore::ConfigStore(const std::vector<rtr::Config>& configs) : dimension_(configs.empty() ? 0 : configs[0].size())
+{
+  initSearchFunctions();
+  reserve(configs.size());
+  for (std::size_t i = 0; i < configs.size(); ++i)
+    append(configs[i], i);
+}
+
+void ConfigStore::reserve(std::size_t num_configs)
+{
+  std::size_t num_blocks = (num_configs + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  values_.reserve(num_blocks * BLOCK_SIZE * dimension_);
+  ids_.reserve(num_blocks * BLOCK_SIZE);
+}
+
+void ConfigStore::append(const rtr::Config& config, std::size_t id)
+{
+  assert(config.size() == dimension_);
+  if (size_ == ids_.size())
+  {
+    values_.resize(values_.size() + BLOCK_SIZE * dimension_, std::numeric_limits<float>::infinity());
+    ids_.resize(ids_.size() + BLOCK_SIZE, 0);
+  }
+  const std::size_t block = size_ / BLOCK_SIZE;
+  const std::size_t lane = size_ % BLOCK_SIZE;
+  for (std::size_t d = 0; d < dimension_; ++d)
+    values_[(block * dimension_ + d) * BLOCK_SIZE + lane] = config[d];
+  ids_[size_++] = id;
+}
+
+template <class Metric, std::size_t DOF>
+bool ConfigStore::getBlockDistances(const float* config, const float* weights, std::size_t block, float cutoff,
+                                    float* distances) const
+{
+  assert(DOF == 0 || DOF == dimension_);
+  const std::size_t dimension = DOF != 0 ? DOF : dimension_;
+  const float* values = &values_[block * dimension * BLOCK_SIZE];
+  const float accumulated_cutoff = Metric::getAccumulatedCutoff(cutoff);
+#if defined(__AVX2__)
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 cutoffs = _mm256_set1_ps(accumulated_cutoff);
+  __m256 sums = _mm256_setzero_ps();
+  for (std::size_t d = 0; d < dimension; ++d, values += BLOCK_SIZE)
+  {
+    __m256 differences = _mm256_sub_ps(_mm256_set1_ps(config[d]), _mm256_loadu_ps(values));
+    __m256 terms = _mm256_mul_ps(_mm256_set1_ps(weights[d]), _mm256_andnot_ps(sign_mask, differences));
+    sums = Metric::accumulate(sums, terms);
+    if (_mm256_movemask_ps(_mm256_cmp_ps(sums, cutoffs, _CMP_LE_OQ)) == 0)
+      return false;
+  }
+  _mm256_storeu_ps(distances, sums);
+#elif defined(__SSE2__)
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  const __m128 cutoffs = _mm_set1_ps(accumulated_cutoff);
+  __m128 sums[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+  for (std::size_t d = 0; d < dimension; ++d, values += BLOCK_SIZE)
+  {
+    const __m128 joint_values = _mm_set1_ps(config[d]);
+    const __m128 joint_weights = _mm_set1_ps(weights[d]);
+    for (std::size_t half = 0; half < 2; ++half)
+    {
+      __m128 differences = _mm_sub_ps(joint_values, _mm_loadu_ps(values + 4 * half));
+      sums[half] = Metric::accumulate(sums[half], _mm_mul_ps(joint_weights, _mm_andnot_ps(sign_mask, differences)));
+    }
+    if ((_mm_movemask_ps(_mm_cmple_ps(sums[0], cutoffs)) | _mm_movemask_ps(_mm_cmple_ps(sums[1], cutoffs))) == 0)
+      return false;
+  }
+  _mm_storeu_ps(distances, sums[0]);
+  _mm_storeu_ps(distances + 4, sums[1]);
+#else
+  std::fill(distances, distances + BLOCK_SIZE, 0.0f);
+  for (std::size_t d = 0; d < dimension; ++d, values += BLOCK_SIZE)
+  {
+    bool any_within_cutoff = false;
+    for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+    {
+      distances[lane] = Metric::accumulate(distances[lane], weights[d] * std::abs(config[d] - values[lane]));
+      any_within_cutoff |= distances[lane] <= accumulated_cutoff;
+    }
+    if (!any_within_cutoff)
+      return false;
+  }
+#endif
+  for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+    distances[lane] = Metric::finish(distances[lane]);
+  return true;
+}
+
+template <class Metric, std::size_t DOF>
+void ConfigStore::searchBlocks(const float* config, const float* weights, std::size_t begin_block,
+                               std::size_t end_block, std::size_t max_results, float distance_threshold,
+                               std::vector<std::pair<float, std::size_t>>& candidates) const
+{
+  float distances[BLOCK_SIZE];
+  for (std::size_t block = begin_block; block < end_block; ++block)
+  {
+    // candidates can't be worse than the worst candidate, or the threshold while the heap is not full
+    float cutoff = candidates.size() < max_results ? distance_threshold : candidates.front().first;
+    if (!getBlockDistances<Metric, DOF>(config, weights, block, cutoff, distances))
+      continue;
+    for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+    {
+      if (!(distances[lane] < distance_threshold))
+        continue;
+      std::pair<float, std::size_t> candidate(distances[lane], ids_[block * BLOCK_SIZE + lane]);
+      if (candidates.size() < max_results)
+      {
+        candidates.push_back(candidate);
+        std::push_heap(candidates.begin(), candidates.end());
+      }
+      else if (candidate < candidates.front())
+      {
+        std::pop_heap(candidates.begin(), candidates.end());
+        candidates.back() = candidate;
+        std::push_heap(candidates.begin(), candidates.end());
+      }
+    }
+  }
+}
+
+void ConfigStore::findClosest(const rtr::Config& config, std::vector<std::size_t>& result_ids,
+                              std::vector<float>& result_distances, const std::size_t max_results,
+                              const float& distance_threshold, const JointDistanceMetric& metric) const
+{
+  result_ids.clear();
+  result_distances.clear();
+  if (ids_.empty() || max_results == 0 || !(distance_threshold > 0.0) || config.size() != dimension_)
+    return;
+
+  std::vector<std::pair<float, std::size_t>> candidates;
+  const std::vector<float> weights = metric.getWeights(dimension_);
+  (this->*search_functions_[metric.type])(config.data(), weights.data(), 0, numBlocks(), max_results,
+                                          distance_threshold, candidates);
+  std::sort_heap(candidates.begin(), candidates.end());
+  for (const std::pair<float, std::size_t>& candidate : candidates)
+  {
+    result_distances.push_back(candidate.first);
+    result_ids.push_back(candidate.second);
+  }
+}
+
+void ConfigStore::findClosestBatch(const std::vector<rtr::Config>& configs,
+                                   std::vector<std::vector<std::size_t>>& result_ids,
+                                   std::vector<std::vector<float>>& result_distances, const std::size_t max_results,
+                                   const float& distance_threshold, const JointDistanceMetric& metric,
+                                   std::size_t num_threads) const
+{
+  result_ids.assign(configs.size(), std::vector<std::size_t>());
+  result_distances.assign(configs.size(), std::vector<float>());
+  if (ids_.empty() || configs.empty() || max_results == 0 || !(distance_threshold > 0.0))
+    return;
+
+  // candidate heaps of all queries per thread
+  const std::size_t num_tiles = (numBlocks() + TILE_BLOCKS - 1) / TILE_BLOCKS;
+  num_threads = std::max<std::size_t>(std::min(num_threads, num_tiles), 1);
+  std::vector<std::vector<std::vector<std::pair<float, std::size_t>>>> thread_candidates(
+      num_threads, std::vector<std::vector<std::pair<float, std::size_t>>>(configs.size()));
+  const std::vector<float> weights = metric.getWeights(dimension_);
+  const SearchFunction search_blocks = search_functions_[metric.type];
+  auto search_tiles = [&](std::size_t thread) {
+    const std::size_t end_tile = num_tiles * (thread + 1) / num_threads;
+    for (std::size_t tile = num_tiles * thread / num_threads; tile < end_tile; ++tile)
+    {
+      const std::size_t end_block = std::min((tile + 1) * TILE_BLOCKS, numBlocks());
+      for (std::size_t i = 0; i < configs.size(); ++i)
+        if (configs[i].size() == dimension_)
+          (this->*search_blocks)(configs[i].data(), weights.data(), tile * TILE_BLOCKS, end_block, max_results,
+                                 distance_threshold, thread_candidates[thread][i]);
+    }
+  };
+  if (num_threads == 1)
+  {
+    search_tiles(0);
+  }
+  else
+  {
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 0; thread < num_threads; ++thread)
+      threads.emplace_back(search_tiles, thread);
+    for (std::thread& thread : threads)
+      thread.join();
+  }
+
+  // merge candidates of all threads, each thread holds the closest candidates of its tiles
+  std::vector<std::pair<float, std::size_t>> candidates;
+  for (std::size_t i = 0; i < configs.size(); ++i)
+  {
+    candidates.clear();
+    for (const std::vector<std::vector<std::pair<float, std::size_t>>>& query_candidates : thread_candidates)
+      candidates.insert(candidates.end(), query_candidates[i].begin(), query_candidates[i].end());
+    std::sort(candidates.begin(), candidates.end());
+    candidates.resize(std::min(candidates.size(), max_results));
+    for (const std::pair<float, std::size_t>& candidate : candidates)
+    {
+      result_distances[i].push_back(candidate.first);
+      result_ids[i].push_back(candidate.second);
+    }
+  }
+}
+
+void ConfigStore::initSearchFunctions()
+{
+  if (dimension_ == 6)
+    setSearchFunctions<6>();
+  else if (dimension_ == 7)
+    setSearchFunctions<7>();
+  else
+    setSearchFunctions<0>();
+}
+
+template <std::size_t DOF>
+void ConfigStore::setSearchFunctions()
+{
+  search_functions_[JointDistanceMetric::L1] = &ConfigStore::searchBlocks<L1Metric, DOF>;
+  search_functions_[JointDistanceMetric::L2] = &ConfigStore::searchBlocks<L2Metric, DOF>;
+  search_functions_[JointDistanceMetric::L_INF] = &ConfigStore::searchBlocks<LInfMetric, DOF>;
+}
+
+QuantizedConfigStore::QuantizedConfigStore(const ConfigsConstPtr& configs)
+  : configs_(configs), dimension_(!configs || configs->empty() ? 0 : configs->front().size())
+{
+  if (dimension_ == 6)
+    setSearchFunctions<6>();
+  else if (dimension_ == 7)
+    setSearchFunctions<7>();
+  else
+    setSearchFunctions<0>();
+
+  offsets_.assign(dimension_, 0.0);
+  scales_.assign(dimension_, 1.0);
+  for (std::size_t d = 0; d < dimension_; ++d)
+  {
+    auto range = std::minmax_element(configs_->begin(), configs_->end(),
+                                     [d](const rtr::Config& a, const rtr::Config& b) { return a[d] < b[d]; });
+    offsets_[d] = range.first->at(d);
+    if (range.second->at(d) > range.first->at(d))
+      scales_[d] = (double(range.second->at(d)) - offsets_[d]) / std::numeric_limits<std::uint16_t>::max();
+  }
+}
+
+void QuantizedConfigStore::reserve(std::size_t num_configs)
+{
+  std::size_t num_blocks = (num_configs + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  codes_.reserve(num_blocks * BLOCK_SIZE * dimension_);
+  ids_.reserve(num_blocks * BLOCK_SIZE);
+}
+
+void QuantizedConfigStore::append(std::size_t id)
+{
+  assert(id < std::numeric_limits<std::uint32_t>::max());
+  if (size_ == ids_.size())
+  {
+    codes_.resize(codes_.size() + BLOCK_SIZE * dimension_, 0);
+    ids_.resize(ids_.size() + BLOCK_SIZE, std::uint32_t(UNUSED_ID));
+  }
+  const std::size_t block = size_ / BLOCK_SIZE;
+  const std::size_t lane = size_ % BLOCK_SIZE;
+  const rtr::Config& config = (*configs_)[id];
+  for (std::size_t d = 0; d < dimension_; ++d)
+    codes_[(block * dimension_ + d) * BLOCK_SIZE + lane] = encode(config[d], d);
+  ids_[size_++] = id;
+}
+
+void QuantizedConfigStore::encodeQuery(const float* config, const float* weights, std::uint16_t* codes,
+                                       float* factors) const
+{
+  for (std::size_t d = 0; d < dimension_; ++d)
+  {
+    codes[d] = encode(config[d], d);
+    // slightly reduced so that float rounding never lets a bound exceed the exact distance
+    factors[d] = weights[d] * scales_[d] * (1.0 - 1e-5);
+  }
+}
+
+template <class Metric, std::size_t DOF>
+bool QuantizedConfigStore::getBlockLowerBounds(const std::uint16_t* codes, const float* factors, std::size_t block,
+                                               float cutoff, float* bounds) const
+{
+  assert(DOF == 0 || DOF == dimension_);
+  const std::size_t dimension = DOF != 0 ? DOF : dimension_;
+  const std::uint16_t* values = &codes_[block * dimension * BLOCK_SIZE];
+  const float accumulated_cutoff = Metric::getAccumulatedCutoff(cutoff);
+#if defined(__AVX2__)
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256 cutoffs = _mm256_set1_ps(accumulated_cutoff);
+  __m256 sums[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+  for (std::size_t d = 0; d < dimension; ++d, values += BLOCK_SIZE)
+  {
+    // saturated code differences minus one code step
+    const __m256i joint_codes = _mm256_set1_epi16(static_cast<short>(codes[d]));
+    const __m256i block_codes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+    __m256i differences = _mm256_or_si256(_mm256_subs_epu16(joint_codes, block_codes),
+                                          _mm256_subs_epu16(block_codes, joint_codes));
+    differences = _mm256_subs_epu16(differences, ones);
+    const __m256 joint_factors = _mm256_set1_ps(factors[d]);
+    for (std::size_t half = 0; half < 2; ++half)
+    {
+      __m128i half_differences =
+          half == 0 ? _mm256_castsi256_si128(differences) : _mm256_extracti128_si256(differences, 1);
+      __m256 terms = _mm256_mul_ps(joint_factors, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(half_differences)));
+      sums[half] = Metric::accumulate(sums[half], terms);
+    }
+    if ((_mm256_movemask_ps(_mm256_cmp_ps(sums[0], cutoffs, _CMP_LE_OQ)) |
+         _mm256_movemask_ps(_mm256_cmp_ps(sums[1], cutoffs, _CMP_LE_OQ))) == 0)
+      return false;
+  }
+  _mm256_storeu_ps(bounds, sums[0]);
+  _mm256_storeu_ps(bounds + 8, sums[1]);
+#elif defined(__SSE2__)
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i zeros = _mm_setzero_si128();
+  const __m128 cutoffs = _mm_set1_ps(accumulated_cutoff);
+  __m128 sums[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+  for (std::size_t d = 0; d < dimension; ++d, values += BLOCK_SIZE)
+  {
+    const __m128i joint_codes = _mm_set1_epi16(static_cast<short>(codes[d]));
+    const __m128 joint_factors = _mm_set1_ps(factors[d]);
+    int within_cutoff = 0;
+    for (std::size_t half = 0; half < 2; ++half)
+    {
+      const __m128i block_codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + 8 * half));
+      __m128i differences =
+          _mm_or_si128(_mm_subs_epu16(joint_codes, block_codes), _mm_subs_epu16(block_codes, joint_codes));
+      differences = _mm_subs_epu16(differences, ones);
+      __m128 low_terms = _mm_mul_ps(joint_factors, _mm_cvtepi32_ps(_mm_unpacklo_epi16(differences, zeros)));
+      __m128 high_terms = _mm_mul_ps(joint_factors, _mm_cvtepi32_ps(_mm_unpackhi_epi16(differences, zeros)));
+      sums[2 * half] = Metric::accumulate(sums[2 * half], low_terms);
+      sums[2 * half + 1] = Metric::accumulate(sums[2 * half + 1], high_terms);
+      within_cutoff |= _mm_movemask_ps(_mm_cmple_ps(sums[2 * half], cutoffs)) |
+                       _mm_movemask_ps(_mm_cmple_ps(sums[2 * half + 1], cutoffs));
+    }
+    if (within_cutoff == 0)
+      return false;
+  }
+  for (std::size_t i = 0; i < 4; ++i)
+    _mm_storeu_ps(bounds + 4 * i, sums[i]);
+#else
+  std::fill(bounds, bounds + BLOCK_SIZE, 0.0f);
+  for (std::size_t d = 0; d < dimension; ++d, values += BLOCK_SIZE)
+  {
+    bool any_within_cutoff = false;
+    for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+    {
+      int difference = std::max(std::abs(int(codes[d]) - int(values[lane])) - 1, 0);
+      bounds[lane] = Metric::accumulate(bounds[lane], factors[d] * float(difference));
+      any_within_cutoff |= bounds[lane] <= accumulated_cutoff;
+    }
+    if (!any_within_cutoff)
+      return false;
+  }
+#endif
+  return true;
+}
+
+template <class Metric, std::size_t DOF>
+void QuantizedConfigStore::searchBlocks(const float* config, const float* weights, const std::uint16_t* codes,
+                                        const float* factors, std::size_t begin_block, std::size_t end_block,
+                                        std::size_t max_results, float distance_threshold,
+                                        std::vector<std::pair<float, std::size_t>>& candidates) const
+{
+  const std::size_t dimension = DOF != 0 ? DOF : dimension_;
+  float bounds[BLOCK_SIZE];
+  for (std::size_t block = begin_block; block < end_block; ++block)
+  {
+    float cutoff = candidates.size() < max_results ? distance_threshold : candidates.front().first;
+    if (!getBlockLowerBounds<Metric, DOF>(codes, factors, block, cutoff, bounds))
+      continue;
+    const float accumulated_cutoff = Metric::getAccumulatedCutoff(cutoff);
+    for (std::size_t lane = 0; lane < BLOCK_SIZE; ++lane)
+    {
+      const std::uint32_t id = ids_[block * BLOCK_SIZE + lane];
+      if (id == UNUSED_ID || bounds[lane] > accumulated_cutoff)
+        continue;
+      // re-rank with the exact distance
+      float distance = getJointDistance<Metric, DOF>(config, (*configs_)[id].data(), weights, dimension);
+      if (!(distance < distance_threshold))
+        continue;
+      std::pair<float, std::size_t> candidate(distance, id);
+      if (candidates.size() < max_results)
+      {
+        candidates.push_back(candidate);
+        std::push_heap(candidates.begin(), candidates.end());
+      }
+      else if (candidate < candidates.front())
+      {
+        std::pop_heap(candidates.begin(), candidates.end());
+        candidates.back() = candidate;
+        std::push_heap(candidates.begin(), candidates.end());
+      }
+    }
+  }
+}
+
+void QuantizedConfigStore::findClosest(const rtr::Config& config, std::vector<std::size_t>& result_ids,
+                                       std::vector<float>& result_distances, const std::size_t max_results,
+                                       const float& distance_threshold, const JointDistanceMetric& metric) const
+{
+  result_ids.clear();
+  result_distances.clear();
+  if (ids_.empty() || max_results == 0 || !(distance_threshold > 0.0) || config.size() != dimension_)
+    return;
+
+  std::vector<std::pair<float, std::size_t>> candidates;
+  const std::vector<float> weights = metric.getWeights(dimension_);
+  std::vector<std::uint16_t> codes(dimension_);
+  std::vector<float> factors(dimension_);
+  encodeQuery(config.data(), weights.data(), codes.data(), factors.data());
+  (this->*search_functions_[metric.type])(config.data(), weights.data(), codes.data(), factors.data(), 0,
+                                          numBlocks(), max_results, distance_threshold, candidates);
+  std::sort_heap(candidates.begin(), candidates.end());
+  for (const std::pair<float, std::size_t>& candidate : candidates)
+  {
+    result_distances.push_back(candidate.first);
+    result_ids.push_back(candidate.second);
+  }
+}
+
+std::uint16_t QuantizedConfigStore::encode(float value, std::size_t d) const
+{
+  double code = std::round((value - offsets_[d]) / scales_[d]);
+  return std::uint16_t(std::max(0.0, std::min<double>(std::numeric_limits<std::uint16_t>::max(), code)));
+}
+
+template <std::size_t DOF>
+void QuantizedConfigStore::setSearchFunctions()
+{
+  search_functions_[JointDistanceMetric::L1] = &QuantizedConfigStore::searchBlocks<L1Metric, DOF>;
+  search_functions_[JointDistanceMetric::L2] = &QuantizedConfigStore::searchBlocks<L2Metric, DOF>;
+  search_functions_[JointDistanceMetric::L_INF] = &QuantizedConfigStore::searchBlocks<LInfMetric, DOF>;
+}
+
+void ConfigIndex::findClosest(const rtr::Config& config, std::vector<std::size_t>& result_ids,
+                              std::vector<float>& result_distances, const std::size_t max_results,
+                              const float& distance_threshold, const JointDistanceMetric& metric) const
+{
+  result_ids.clear();
+  result_distances.clear();
+  if (size_ == 0 || max_results == 0 || !(distance_threshold > 0.0) || config.size() != dimension_)
+    return;
+
+  const std::vector<float> weights = metric.getWeights(dimension_);
+  Query query{ config.data(), weights.data(), max_results, distance_threshold,
+               std::vector<double>(dimension_, 0.0), {}, {}, {} };
+  if (quantized_)
+  {
+    query.codes.resize(dimension_);
+    query.factors.resize(dimension_);
+    quantized_store_.encodeQuery(query.config, query.weights, query.codes.data(), query.factors.data());
+  }
+  (this->*search_functions_[metric.type])(0, 0.0, query);
+
+  std::vector<std::pair<float, std::size_t>>& candidates = query.candidates;
+  std::sort_heap(candidates.begin(), candidates.end());
+  for (const std::pair<float, std::size_t>& candidate : candidates)
+  {
+    result_distances.push_back(candidate.first);
+    result_ids.push_back(candidate.second);
+  }
+}
+
+std::ptrdiff_t ConfigIndex::findClosestId(const rtr::Config& config, const float& distance_threshold,
+                                          const JointDistanceMetric& metric) const
+{
+  std::vector<std::size_t> result_ids;
+  std::vector<float> result_distances;
+  findClosest(config, result_ids, result_distances, 1, distance_threshold, metric);
+  return result_ids.empty() ? -1 : result_ids[0];
+}
+
+void ConfigIndex::findClosestBatch(const std::vector<rtr::Config>& configs,
+                                   std::vector<std::vector<std::size_t>>& result_ids,
+                                   std::vector<std::vector<float>>& result_distances, const std::size_t max_results,
+                                   const float& distance_threshold, const JointDistanceMetric& metric,
+                                   std::size_t num_threads) const
+{
+  result_ids.resize(configs.size());
+  result_distances.resize(configs.size());
+  const std::size_t chunk_size = 16;
+  std::atomic<std::size_t> next_chunk(0);
+  auto search_chunks = [&]() {
+    for (std::size_t begin = chunk_size * next_chunk++; begin < configs.size(); begin = chunk_size * next_chunk++)
+      for (std::size_t i = begin; i < std::min(begin + chunk_size, configs.size()); ++i)
+        findClosest(configs[i], result_ids[i], result_distances[i], max_results, distance_threshold, metric);
+  };
+  num_threads = std::max<std::size_t>(std::min(num_threads, (configs.size() + chunk_size - 1) / chunk_size), 1);
+  if (num_threads == 1)
+  {
+    search_chunks();
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (std::size_t thread = 0; thread < num_threads; ++thread)
+    threads.emplace_back(search_chunks);
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
+void ConfigIndex::build(const std::vector<rtr::Config>& configs)
+{
+  if (dimension_ == 6)
+    setSearchFunctions<6>();
+  else if (dimension_ == 7)
+    setSearchFunctions<7>();
+  else
+    setSearchFunctions<0>();
+
+  std::vector<std::size_t> ids(configs.size());
+  for (std::size_t i = 0; i < ids.size(); ++i)
+    ids[i] = i;
+  if (ids.empty())
+    return;
+  buildNode(configs, ids, 0, ids.size());
+
+  if (quantized_)
+    quantized_store_.reserve(ids.size() + nodes_.size() * QuantizedConfigStore::BLOCK_SIZE / 2);
+  else
+    store_.reserve(ids.size() + nodes_.size() * ConfigStore::BLOCK_SIZE / 2);
+  for (Node& node : nodes_)
+  {
+    if (node.children[0] != 0)
+      continue;
+    if (quantized_)
+    {
+      std::size_t begin_block = quantized_store_.numBlocks();
+      for (std::size_t i = node.begin; i < node.end; ++i)
+        quantized_store_.append(ids[i]);
+      quantized_store_.finishBlock();
+      node.begin = begin_block;
+      node.end = quantized_store_.numBlocks();
+    }
+    else
+    {
+      std::size_t begin_block = store_.numBlocks();
+      for (std::size_t i = node.begin; i < node.end; ++i)
+        store_.append(configs[ids[i]], ids[i]);
+      store_.finishBlock();
+      node.begin = begin_block;
+      node.end = store_.numBlocks();
+    }
+  }
+}
+
+std::size_t ConfigIndex::buildNode(const std::vector<rtr::Config>& configs, std::vector<std::size_t>& ids,
+                                   std::size_t begin, std::size_t end)
+{
+  std::size_t node_index = nodes_.size();
+  nodes_.push_back(Node{ begin, end, 0, 0.0f, { 0, 0 } });
+  if (end - begin <= leaf_size_)
+    return node_index;
+
+  float max_spread = -1.0;
+  std::size_t split_dimension = 0;
+  for (std::size_t d = 0; d < dimension_; ++d)
+  {
+    auto range = std::minmax_element(ids.begin() + begin, ids.begin() + end, [&](std::size_t a, std::size_t b) {
+      return configs[a][d] < configs[b][d];
+    });
+    float spread = configs[*range.second][d] - configs[*range.first][d];
+    if (spread > max_spread)
+    {
+      max_spread = spread;
+      split_dimension = d;
+    }
+  }
+  if (!(max_spread > 0.0))
+    return node_index;  // all configs are equal
+
+  std::size_t mid = begin + (end - begin) / 2;
+  std::nth_element(ids.begin() + begin, ids.begin() + mid, ids.begin() + end, [&](std::size_t a, std::size_t b) {
+    return configs[a][split_dimension] < configs[b][split_dimension];
+  });
+  nodes_[node_index].split_dimension = split_dimension;
+  nodes_[node_index].split_value = configs[ids[mid]][split_dimension];
+  std::size_t lower = buildNode(configs, ids, begin, mid);
+  std::size_t upper = buildNode(configs, ids, mid, end);
+  nodes_[node_index].children[0] = lower;
+  nodes_[node_index].children[1] = upper;
+  return node_index;
+}
+
+double ConfigIndex::getPruningBound(const Query& query)
+{
+  double bound = query.candidates.size() < query.max_results ? query.distance_threshold :
+                                                                query.candidates.front().first;
+  return bound * (1.0 + 1e-5) + 1e-6;
+}
+
+template <class Metric, std::size_t DOF>
+void ConfigIndex::searchNode(std::size_t node_index, double lower_bound, Query& query) const
+{
+  const Node& node = nodes_[node_index];
+  if (node.children[0] == 0)
+  {
+    if (quantized_)
+      quantized_store_.searchBlocks<Metric, DOF>(query.config, query.weights, query.codes.data(),
+                                                 query.factors.data(), node.begin, node.end, query.max_results,
+                                                 query.distance_threshold, query.candidates);
+    else
+      store_.searchBlocks<Metric, DOF>(query.config, query.weights, node.begin, node.end, query.max_results,
+                                       query.distance_threshold, query.candidates);
+    return;
+  }
+
+  // search the closer child first, the other child is only searched if its bound is within the candidate bound
+  const std::size_t d = node.split_dimension;
+  const double split_offset = double(query.config[d]) - node.split_value;
+  const std::size_t near_child = split_offset < 0.0 ? 0 : 1;
+  searchNode<Metric, DOF>(node.children[near_child], lower_bound, query);
+
+  const double previous_offset = query.offsets[d];
+  const double far_offset = std::max(previous_offset, query.weights[d] * std::abs(split_offset));
+  const double far_bound = Metric::replace(lower_bound, previous_offset, far_offset);
+  if (Metric::finish(far_bound) <= getPruningBound(query))
+  {
+    query.offsets[d] = far_offset;
+    searchNode<Metric, DOF>(node.children[1 - near_child], far_bound, query);
+    query.offsets[d] = previous_offset;
+  }
+}
+
+template <std::size_t DOF>
+void ConfigIndex::setSearchFunctions()
+{
+  search_functions_[JointDistanceMetric::L1] = &ConfigIndex::searchNode<L1Metric, DOF>;
+  search_functions_[JointDistanceMetric::L2] = &ConfigIndex::searchNode<L2Metric, DOF>;
+  search_functions_[JointDistanceMetric::L_INF] = &ConfigIndex::searchNode<LInfMetric, DOF>;
+}
+
+PoseIndex::PoseIndex(const std::vector<rtr::ToolPose>& poses, double poses_per_cell) : poses_(poses)
+{
+  if (poses_.empty())
+    return;
+
+  // cell size from the bounding box volume, flat extents are padded
+  std::array<double, 3> max_position;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+  {
+    min_position_[axis] = max_position[axis] = poses_[0][axis];
+    for (const rtr::ToolPose& pose : poses_)
+    {
+      min_position_[axis] = std::min<double>(min_position_[axis], pose[axis]);
+      max_position[axis] = std::max<double>(max_position[axis], pose[axis]);
+    }
+  }
+  double max_extent = 0.0;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+    max_extent = std::max(max_extent, max_position[axis] - min_position_[axis]);
+  double volume = 1.0;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+    volume *= std::max(max_position[axis] - min_position_[axis], 1e-3 * max_extent + 1e-6);
+  cell_size_ = std::cbrt(volume * std::max(poses_per_cell, 1.0) / poses_.size());
+  for (std::size_t axis = 0; axis < 3; ++axis)
+    cells_[axis] = std::max(1L, long(std::floor((max_position[axis] - min_position_[axis]) / cell_size_)) + 1);
+
+  // sort poses by cell, poses of a cell are stored in ids_[cell_starts_[cell], cell_starts_[cell + 1])
+  std::vector<std::size_t> pose_cells(poses_.size());
+  cell_starts_.assign(cells_[0] * cells_[1] * cells_[2] + 1, 0);
+  for (std::size_t i = 0; i < poses_.size(); ++i)
+  {
+    std::array<long, 3> cell = getCell(poses_[i]);
+    pose_cells[i] = getCellIndex(cell[0], cell[1], cell[2]);
+    ++cell_starts_[pose_cells[i] + 1];
+  }
+  for (std::size_t i = 1; i < cell_starts_.size(); ++i)
+    cell_starts_[i] += cell_starts_[i - 1];
+  ids_.resize(poses_.size());
+  std::vector<std::size_t> cell_ends(cell_starts_.begin(), cell_starts_.end() - 1);
+  for (std::size_t i = 0; i < poses_.size(); ++i)
+    ids_[cell_ends[pose_cells[i]]++] = i;
+
+  // sort the poses of each cell by orientation bin, poses of a bin keep their index order
+  std::vector<std::array<double, 4>> quaternions(poses_.size());
+  std::vector<std::size_t> pose_bins(poses_.size());
+  for (std::size_t i = 0; i < poses_.size(); ++i)
+  {
+    quaternions[i] = getOrientationQuaternion(poses_[i]);
+    pose_bins[i] = getOrientationBin(getToolAxis(quaternions[i]));
+  }
+  bin_starts_.assign(cell_starts_.size(), 0);
+  orientations_.resize(poses_.size());
+  for (std::size_t cell = 0; cell + 1 < cell_starts_.size(); ++cell)
+  {
+    std::stable_sort(ids_.begin() + cell_starts_[cell], ids_.begin() + cell_starts_[cell + 1],
+                     [&pose_bins](std::size_t a, std::size_t b) { return pose_bins[a] < pose_bins[b]; });
+    for (std::size_t i = cell_starts_[cell]; i < cell_starts_[cell + 1]; ++i)
+      orientations_[i] = quaternions[ids_[i]];
+    for (std::size_t i = cell_starts_[cell]; i < cell_starts_[cell + 1]; ++i)
+      if (i == cell_starts_[cell] || pose_bins[ids_[i]] != pose_bins[ids_[i - 1]])
+        bins_.push_back(createOrientationBin(i, cell_starts_[cell + 1], pose_bins));
+    bin_starts_[cell + 1] = bins_.size();
+  }
+}
+
+void PoseIndex::findClosest(const rtr::ToolPose& pose, std::vector<std::size_t>& result_ids,
+                            std::vector<float>& result_distances, const std::size_t max_results,
+                            const float& distance_threshold) const
+{
+  result_ids.clear();
+  result_distances.clear();
+  if (poses_.empty() || max_results == 0 || !(distance_threshold > 0.0))
+    return;
+
+  // visit cells in growing shells around the query cell until all remaining cells are out of reach
+  std::vector<std::pair<float, std::size_t>> candidates;  // max-heap of (distance, id)
+  const std::array<long, 3> center = getCell(pose);
+  for (long shell = 0;; ++shell)
+  {
+    std::array<long, 3> min_cell, max_cell;
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+      min_cell[axis] = std::max(center[axis] - shell, 0L);
+      max_cell[axis] = std::min(center[axis] + shell, cells_[axis] - 1);
+    }
+    for (long x = min_cell[0]; x <= max_cell[0]; ++x)
+      for (long y = min_cell[1]; y <= max_cell[1]; ++y)
+        for (long z = min_cell[2]; z <= max_cell[2]; ++z)
+          if (std::max(std::max(std::abs(x - center[0]), std::abs(y - center[1])), std::abs(z - center[2])) == shell)
+            searchCell(getCellIndex(x, y, z), pose, max_results, distance_threshold, candidates);
+
+    // distance of the query position to the closest cell outside of the visited shells
+    double outside_distance = DBL_MAX;
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+      if (min_cell[axis] > 0)
+        outside_distance =
+            std::min(outside_distance, pose[axis] - (min_position_[axis] + min_cell[axis] * cell_size_));
+      if (max_cell[axis] < cells_[axis] - 1)
+        outside_distance =
+            std::min(outside_distance, min_position_[axis] + (max_cell[axis] + 1) * cell_size_ - pose[axis]);
+    }
+    if (outside_distance == DBL_MAX)
+      break;  // all cells visited
+    // slack compensates float rounding in getPositionDistance()
+    double bound = candidates.size() < max_results ? distance_threshold : candidates.front().first;
+    if (outside_distance > bound * (1.0 + 1e-5) + 1e-6)
+      break;
+  }
+
+  std::sort_heap(candidates.begin(), candidates.end());
+  for (const std::pair<float, std::size_t>& candidate : candidates)
+  {
+    result_distances.push_back(candidate.first);
+    result_ids.push_back(candidate.second);
+  }
+}
+
+void PoseIndex::findClosest(const rtr::ToolPose& pose, std::vector<std::size_t>& result_ids,
+                            const std::size_t max_results, const float& distance_threshold) const
+{
+  std::vector<float> result_distances;
+  findClosest(pose, result_ids, result_distances, max_results, distance_threshold);
+}
+
+void PoseIndex::findWithinTolerance(const rtr::ToolPose& pose, std::vector<std::size_t>& result_ids,
+                                    std::vector<float>& result_distances, const float& position_threshold,
+                                    const float& orientation_threshold) const
+{
+  result_ids.clear();
+  result_distances.clear();
+  if (poses_.empty() || !(position_threshold > 0.0) || !(orientation_threshold > 0.0))
+    return;
+
+  // visit all cells that intersect the ball of the position threshold around the query position
+  const std::array<double, 4> orientation = getOrientationQuaternion(pose);
+  const std::array<double, 3> tool_axis = getToolAxis(orientation);
+  std::array<long, 3> min_cell, max_cell;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+  {
+    double extent = std::min<double>(position_threshold, DBL_MAX / 4);
+    min_cell[axis] = getCellCoordinate(pose[axis] - extent, axis);
+    max_cell[axis] = getCellCoordinate(pose[axis] + extent, axis);
+  }
+  std::vector<std::pair<float, std::size_t>> candidates;
+  for (long x = min_cell[0]; x <= max_cell[0]; ++x)
+    for (long y = min_cell[1]; y <= max_cell[1]; ++y)
+      for (long z = min_cell[2]; z <= max_cell[2]; ++z)
+      {
+        // slack compensates float rounding in getPositionDistance()
+        if (getCellDistance(x, y, z, pose) > position_threshold * (1.0 + 1e-5) + 1e-6)
+          continue;
+        std::size_t cell_index = getCellIndex(x, y, z);
+        for (std::size_t bin = bin_starts_[cell_index]; bin < bin_starts_[cell_index + 1]; ++bin)
+        {
+          if (getAxisAngle(tool_axis, bins_[bin].axis) - bins_[bin].radius > orientation_threshold + 1e-6)
+            continue;
+          for (std::size_t i = bins_[bin].begin; i < bins_[bin].end; ++i)
+          {
+            float distance = getPositionDistance(pose, poses_[ids_[i]]);
+            if (distance < position_threshold &&
+                float(getQuaternionDistance(orientation, orientations_[i])) < orientation_threshold)
+              candidates.emplace_back(distance, ids_[i]);
+          }
+        }
+      }
+
+  std::sort(candidates.begin(), candidates.end());
+  result_ids.reserve(candidates.size());
+  result_distances.reserve(candidates.size());
+  for (const std::pair<float, std::size_t>& candidate : candidates)
+  {
+    result_distances.push_back(candidate.first);
+    result_ids.push_back(candidate.second);
+  }
+}
+
+std::array<double, 3> PoseIndex::getToolAxis(const std::array<double, 4>& q)
+{
+  return { { 2.0 * (q[1] * q[3] + q[0] * q[2]), 2.0 * (q[2] * q[3] - q[0] * q[1]),
+             1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2]) } };
+}
+
+double PoseIndex::getAxisAngle(const std::array<double, 3>& first, const std::array<double, 3>& second)
+{
+  const double cross_x = first[1] * second[2] - first[2] * second[1];
+  const double cross_y = first[2] * second[0] - first[0] * second[2];
+  const double cross_z = first[0] * second[1] - first[1] * second[0];
+  const double dot = first[0] * second[0] + first[1] * second[1] + first[2] * second[2];
+  return std::atan2(std::sqrt(cross_x * cross_x + cross_y * cross_y + cross_z * cross_z), dot);
+}
+
+std::size_t PoseIndex::getOrientationBin(const std::array<double, 3>& axis)
+{
+  std::size_t face = 0;
+  for (std::size_t i = 1; i < 3; ++i)
+    if (std::abs(axis[i]) > std::abs(axis[face]))
+      face = i;
+  const std::size_t u = (face + 1) % 3, v = (face + 2) % 3;
+  return (2 * face + (axis[face] < 0.0)) * 4 + 2 * (axis[u] < 0.0) + (axis[v] < 0.0);
+}
+
+PoseIndex::OrientationBin PoseIndex::createOrientationBin(std::size_t begin, std::size_t cell_end,
+                                                          const std::vector<std::size_t>& pose_bins) const
+{
+  OrientationBin bin;
+  bin.begin = begin;
+  bin.end = begin;
+  bin.axis = { { 0.0, 0.0, 0.0 } };
+  while (bin.end < cell_end && pose_bins[ids_[bin.end]] == pose_bins[ids_[begin]])
+  {
+    std::array<double, 3> tool_axis = getToolAxis(orientations_[bin.end++]);
+    for (std::size_t i = 0; i < 3; ++i)
+      bin.axis[i] += tool_axis[i];
+  }
+  // the axes of a bin lie in one octant so their sum is never zero
+  double norm = std::sqrt(bin.axis[0] * bin.axis[0] + bin.axis[1] * bin.axis[1] + bin.axis[2] * bin.axis[2]);
+  for (std::size_t i = 0; i < 3; ++i)
+    bin.axis[i] /= norm;
+  bin.radius = 0.0;
+  for (std::size_t i = bin.begin; i < bin.end; ++i)
+    bin.radius = std::max(bin.radius, getAxisAngle(bin.axis, getToolAxis(orientations_[i])));
+  return bin;
+}
+
+long PoseIndex::getCellCoordinate(double position, std::size_t axis) const
+{
+  double coordinate = std::floor((position - min_position_[axis]) / cell_size_);
+  return long(std::max(0.0, std::min<double>(cells_[axis] - 1, coordinate)));
+}
+
+std::array<long, 3> PoseIndex::getCell(const rtr::ToolPose& pose) const
+{
+  std::array<long, 3> cell;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+    cell[axis] = getCellCoordinate(pose[axis], axis);
+  return cell;
+}
+
+double PoseIndex::getCellDistance(long x, long y, long z, const rtr::ToolPose& pose) const
+{
+  const std::array<long, 3> cell = { { x, y, z } };
+  double distance = 0.0;
+  for (std::size_t axis = 0; axis < 3; ++axis)
+  {
+    double offset = 0.0;
+    if (cell[axis] > 0)
+      offset = std::max(offset, min_position_[axis] + cell[axis] * cell_size_ - pose[axis]);
+    if (cell[axis] < cells_[axis] - 1)
+      offset = std::max(offset, pose[axis] - (min_position_[axis] + (cell[axis] + 1) * cell_size_));
+    distance += offset * offset;
+  }
+  return std::sqrt(distance);
+}
+
+void PoseIndex::searchCell(std::size_t cell_index, const rtr::ToolPose& pose, std::size_t max_results,
+                           float distance_threshold, std::vector<std::pair<float, std::size_t>>& candidates) const
+{
+  for (std::size_t i = cell_starts_[cell_index]; i < cell_starts_[cell_index + 1]; ++i)
+  {
+    float distance = getPositionDistance(pose, poses_[ids_[i]]);
+    if (!(distance < distance_threshold))
+      continue;
+    std::pair<float, std::size_t> candidate(distance, ids_[i]);
+    if (candidates.size() < max_results)
+    {
+      candidates.push_back(candidate);
+      std::push_heap(candidates.begin(), candidates.end());
+    }
+    else if (candidate < candidates.front())
+    {
+      std::pop_heap(candidates.begin(), candidates.end());
+      candidates.back() = candidate;
+      std::push_heap(candidates.begin(), candidates.end());
+    }
+  }
+}
+}  // namespace rtr_moveit
@@ -0,0 +1,146 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Process-wide store of roadmap data and search indices shared by all planning contexts
+ */
+
+#include <rtr_moveit/roadmap_store.h>
+
+// C++
+#include <boost/filesystem.hpp>
+
+// ROS
+#include <ros/ros.h>
+
+namespace rtr_moveit
+{
+const std::string LOGNAME = "roadmap_store";
+
+RoadmapDataConstPtr RoadmapStore::getRoadmap(const RoadmapSpecification& roadmap_spec)
+{
+  boost::system::error_code error;
+  std::time_t modification_time = boost::filesystem::last_write_time(roadmap_spec.og_file, error);
+  if (error)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to access roadmap file '" << roadmap_spec.og_file << "'");
+    return RoadmapDataConstPtr();
+  }
+
+  // return loaded roadmap if the file hasn't changed
+  {  // SCOPED MUTEX LOCK
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry_search = entries_.find(roadmap_spec.roadmap_id);
+    if (entry_search != entries_.end())
+    {
+      const RoadmapDataConstPtr& roadmap = entry_search->second.roadmap;
+      if (roadmap->og_file == roadmap_spec.og_file && roadmap->modification_time == modification_time)
+        return roadmap;
+    }
+  }  // SCOPED MUTEX UNLOCK
+
+  // the file is read without holding the lock so that requests of other roadmaps are not blocked, the sidecar file
+  // is preferred since it can be mapped without parsing
+  std::shared_ptr<RoadmapData> roadmap = std::make_shared<RoadmapData>();
+  const std::string sidecar_file = getRoadmapSidecarFile(roadmap_spec.og_file);
+  if (loadRoadmapSidecar(sidecar_file, roadmap_spec.og_file, *roadmap))
+  {
+    ROS_INFO_STREAM_NAMED(LOGNAME, "Loaded roadmap '" << roadmap_spec.roadmap_id << "' from: " << sidecar_file);
+  }
+  else
+  {
+    ROS_INFO_STREAM_NAMED(LOGNAME,
+                          "Loading roadmap '" << roadmap_spec.roadmap_id << "' from: " << roadmap_spec.og_file);
+    *roadmap = RoadmapData();
+    if (!loadRoadmapFile(roadmap_spec.og_file, *roadmap))
+      return RoadmapDataConstPtr();
+  }
+
+  // replace the entry, indices of the previous data are rebuilt on demand
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[roadmap_spec.roadmap_id];
+  entry.roadmap = roadmap;
+  entry.config_index.reset();
+  entry.pose_index.reset();
+  return roadmap;
+}
+
+ConfigIndexConstPtr RoadmapStore::getConfigIndex(const std::string& roadmap_id, const RoadmapDataConstPtr& roadmap,
+                                                 bool quantized)
+{
+  {  // SCOPED MUTEX LOCK
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Entry& entry = entries_[roadmap_id];
+    if (entry.config_index && entry.config_index->getConfigs() == roadmap->configs &&
+        entry.config_index->isQuantized() == quantized)
+      return entry.config_index;
+  }  // SCOPED MUTEX UNLOCK
+
+  // the index is built without holding the lock so that requests of other roadmaps are not blocked
+  ConfigIndexConstPtr config_index = std::make_shared<const ConfigIndex>(roadmap->configs, quantized);
+
+  // only cache indices of current roadmap data
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[roadmap_id];
+  if (entry.roadmap == roadmap)
+    entry.config_index = config_index;
+  return config_index;
+}
+
+PoseIndexConstPtr RoadmapStore::getPoseIndex(const std::string& roadmap_id, const RoadmapDataConstPtr& roadmap)
+{
+  {  // SCOPED MUTEX LOCK
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Entry& entry = entries_[roadmap_id];
+    if (entry.pose_index && entry.roadmap == roadmap)
+      return entry.pose_index;
+  }  // SCOPED MUTEX UNLOCK
+
+  // the index is built without holding the lock so that requests of other roadmaps are not blocked
+  PoseIndexConstPtr pose_index = std::make_shared<const PoseIndex>(roadmap->poses);
+
+  // only cache indices of current roadmap data
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[roadmap_id];
+  if (entry.roadmap == roadmap)
+    entry.pose_index = pose_index;
+  return pose_index;
+}
+
+void RoadmapStore::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+}  // namespace rtr_moveit
@@ -56,6 +56,32 @@ namespace rtr_moveit
 {
 static const std::string LOGNAME = "rtr_planner_interface";
 
+namespace
+{
+// The PathPlanner takes edge cost functions without state, so the joint weights of the active metric are stored
+// here. They are shared by all planner interfaces and only modified and used while edge_cost_mutex is locked.
+// The weights always match the dimension of the roadmap loaded in the PathPlanner that is searched.
+std::vector<float> edge_cost_weights;
+std::mutex edge_cost_mutex;
+
+template <class Metric, std::size_t DOF>
+float getEdgeCost(const rtr::Config& first, const rtr::Config& second)
+{
+  return getJointDistance<Metric, DOF>(first.data(), second.data(), edge_cost_weights.data(), first.size());
+}
+
+/** Returns the edge cost function of a metric, fixed DOF instantiations are used for 6 and 7 joint roadmaps */
+template <class Metric>
+float (*getEdgeCostFunction(std::size_t dimension))(const rtr::Config&, const rtr::Config&)
+{
+  if (dimension == 6)
+    return &getEdgeCost<Metric, 6>;
+  if (dimension == 7)
+    return &getEdgeCost<Metric, 7>;
+  return &getEdgeCost<Metric, 0>;
+}
+}  // namespace
+
 RTRPlannerInterface::RTRPlannerInterface(const ros::NodeHandle& nh) : nh_(nh)
 {
   // Check if RapidPlan hardware should be used for collision checking
@@ -175,9 +201,21 @@ bool RTRPlannerInterface::solve(const RoadmapSpecification& roadmap_spec, const
                                 const RapidPlanGoal& goal, const OccupancyData& occupancy_data, const double& timeout,
                                 std::vector<rtr::Config>& roadmap_states, std::deque<std::size_t>& waypoints,
                                 std::deque<std::size_t>& edges)
+{
+  SceneCollisions collisions;
+  if (!checkScene(roadmap_spec, occupancy_data, collisions) ||
+      !findPath(collisions, start_state_id, goal, timeout, waypoints, edges))
+    return false;
+
+  // return state configs
+  return getRoadmapConfigs(roadmap_spec, roadmap_states);
+}
+
+bool RTRPlannerInterface::checkScene(const RoadmapSpecification& roadmap_spec, const OccupancyData& occupancy_data,
+                                     SceneCollisions& collisions)
 {
   {  // SCOPED MUTEX LOCK
-    // In solve() the RapidPlanInterface and PathPlanner are loaded with the same roadmap so that results from
+    // The RapidPlanInterface and PathPlanner are loaded with the same roadmap so that results from
     // RapidPlanInterface::CheckScene() can be used with PathPlanner::FindPath().
     // Calling prepareRoadmap() ensures that both are loaded with the same roadmap and the mutex lock prevents race
     // conditions by restricting write access in the meantime.
@@ -190,14 +228,17 @@ bool RTRPlannerInterface::solve(const RoadmapSpecification& roadmap_spec, const
       return false;
 
     // Check collisions using the RapidPlanInterface
-    std::vector<uint8_t> collisions;
+    collisions.roadmap = roadmap_spec;
+    collisions.edge_collisions.clear();
     if (rapidplan_interface_enabled_)
     {
       bool check_scene_success = false;
       if (occupancy_data.type == OccupancyData::Type::POINT_CLOUD)
-        check_scene_success = rapidplan_interface_.CheckScene(occupancy_data.point_cloud, roadmap_index, collisions);
+        check_scene_success =
+            rapidplan_interface_.CheckScene(occupancy_data.point_cloud, roadmap_index, collisions.edge_collisions);
       else if (occupancy_data.type == OccupancyData::Type::VOXELS)
-        check_scene_success = rapidplan_interface_.CheckScene(occupancy_data.voxels, roadmap_index, collisions);
+        check_scene_success =
+            rapidplan_interface_.CheckScene(occupancy_data.voxels, roadmap_index, collisions.edge_collisions);
       else
         ROS_WARN_NAMED(LOGNAME, "No type specified in occupancy data");
 
@@ -210,25 +251,47 @@ bool RTRPlannerInterface::solve(const RoadmapSpecification& roadmap_spec, const
     else
     {
       ROS_WARN_NAMED(LOGNAME, "RapidPlan called with disabled collision checks");
-      collisions.resize(planner_.GetNumEdges());  // dummy
+      collisions.edge_collisions.resize(planner_.GetNumEdges());  // dummy
+    }
+    return true;
+  }  // SCOPED MUTEX UNLOCK
+}
+
+bool RTRPlannerInterface::findPath(const SceneCollisions& collisions, const std::size_t start_state_id,
+                                   const RapidPlanGoal& goal, const double& timeout, std::deque<std::size_t>& waypoints,
+                                   std::deque<std::size_t>& edges)
+{
+  {  // SCOPED MUTEX LOCK
+    // The PathPlanner may have been loaded with another roadmap since the scene was checked
+    std::lock_guard<std::mutex> scoped_lock(mutex_);
+    if (!loadRoadmapToPathPlanner(collisions.roadmap))
+      return false;
+    if (collisions.edge_collisions.size() != static_cast<std::size_t>(planner_.GetNumEdges()))
+    {
+      ROS_ERROR_STREAM_NAMED(LOGNAME, "Scene collisions don't match the edges of roadmap '"
+                                          << collisions.roadmap.roadmap_id << "'");
+      return false;
     }
 
-    // Call PathPlanner
+    // Call PathPlanner, the edge cost weights are locked until the search is finished
     int result = -1;
+    std::unique_lock<std::mutex> edge_cost_lock(edge_cost_mutex);
+    setEdgeCost(collisions.roadmap.joint_metric, loaded_roadmap_dimension_);
     if (goal.type == RapidPlanGoal::Type::TOOL_POSE)
     {
-      result = planner_.FindPath(start_state_id, goal.tool_pose, collisions, goal.tolerance, goal.weights, waypoints,
-                                 edges, timeout);
+      result = planner_.FindPath(start_state_id, goal.tool_pose, collisions.edge_collisions, goal.tolerance,
+                                 goal.weights, waypoints, edges, timeout);
     }
     else if (goal.type == RapidPlanGoal::Type::STATE_IDS)
     {
-      result = planner_.FindPath(start_state_id, goal.state_ids, collisions, waypoints, edges, timeout);
+      result = planner_.FindPath(start_state_id, goal.state_ids, collisions.edge_collisions, waypoints, edges, timeout);
     }
     else
     {
       ROS_ERROR_NAMED(LOGNAME, "RapidPlanGoal goal type missing - Should be TOOL_POSE or STATE_IDS");
       return false;
     }
+    edge_cost_lock.unlock();
 
     // debug output
     if (debug_)
@@ -261,8 +324,7 @@ bool RTRPlannerInterface::solve(const RoadmapSpecification& roadmap_spec, const
 
     // SUCCESS
     ROS_INFO_STREAM_NAMED(LOGNAME, "RapidPlan found solution path with " << waypoints.size() << " waypoints");
-    roadmap_states = planner_.GetConfigs();  // return state configs
-    return result == 0;
+    return true;
   }  // SCOPED MUTEX UNLOCK
 }
 
@@ -315,19 +377,42 @@ bool RTRPlannerInterface::loadRoadmapToPathPlanner(const RoadmapSpecification& r
       std::cout << roadmap_spec.og_file << std::endl;
       return false;
     }
+    const std::vector<rtr::Config>& configs = planner_.GetConfigs();
+    loaded_roadmap_dimension_ = configs.empty() ? 0 : configs.front().size();
 
     // save new roadmap if it is new
     // TODO(RTR-51): Only store *.og file paths, others will be deprecated with the next API
     if (roadmaps_.find(roadmap_spec.roadmap_id) == roadmaps_.end())
       roadmaps_[roadmap_spec.roadmap_id] = roadmap_spec;
     loaded_roadmap_ = roadmap_spec.roadmap_id;
-
-    // set edge cost as simple joint distance - TODO(RTR-55): use weighted distance?
-    planner_.SetEdgeCost(&getConfigDistance);
   }
   return true;
 }
 
+void RTRPlannerInterface::setEdgeCost(const JointDistanceMetric& joint_metric, std::size_t dimension)
+{
+  // set edge cost to the joint distance metric of the roadmap's planning group, the weights need to match the joint
+  // dimension of the roadmap since the cost functions read one weight per joint
+  edge_cost_weights = joint_metric.getWeights(dimension);
+  if (!joint_metric.weights.empty() && joint_metric.weights.size() != dimension)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Number of joint weights does not fit to joint count of roadmap ("
+                                       << dimension << "). Using default weights: 1.0");
+    edge_cost_weights.assign(dimension, 1.0f);
+  }
+  switch (joint_metric.type)
+  {
+    case JointDistanceMetric::L2:
+      planner_.SetEdgeCost(getEdgeCostFunction<L2Metric>(dimension));
+      break;
+    case JointDistanceMetric::L_INF:
+      planner_.SetEdgeCost(getEdgeCostFunction<LInfMetric>(dimension));
+      break;
+    default:
+      planner_.SetEdgeCost(getEdgeCostFunction<L1Metric>(dimension));
+  }
+}
+
 bool RTRPlannerInterface::prepareRoadmap(const RoadmapSpecification& roadmap_spec, size_t& roadmap_index)
 {
   if (!loadRoadmapToPathPlanner(roadmap_spec))
@@ -37,10 +37,15 @@
  */
 
 // C++
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 
 // MoveIt!
@@ -52,10 +57,14 @@
 #include <rtr_moveit/rtr_planning_context.h>
 #include <rtr_moveit/rtr_planner_interface.h>
 #include <rtr_moveit/roadmap_visualization.h>
+#include <rtr_moveit/occupancy_handler.h>
+#include <rtr_moveit/roadmap_store.h>
 
 // ROS parameter loading
+#include <dynamic_reconfigure/server.h>
 #include <ros/package.h>
 #include <rosparam_shortcuts/rosparam_shortcuts.h>
+#include <rtr_moveit/RTRPlannerConfig.h>
 
 namespace rtr_moveit
 {
@@ -66,6 +75,9 @@ const std::string PLANNER_DESCRIPTION = "RapidPlan";
 // default roadmap planner id (NOTE: in the future we could support diferent selection modes)
 const std::string ROADMAP_DEFAULT = "Default";
 
+// maximum number of planning contexts that are kept for reuse per planning group and roadmap
+const std::size_t MAX_POOLED_PLANNING_CONTEXTS = 4;
+
 class RTRPlannerManager : public planning_interface::PlannerManager
 {
 public:
@@ -103,6 +115,25 @@ public:
       nh_.setParam("/move_group/" + group_configs_item.first + "/default_planner_config", ROADMAP_DEFAULT);
 
     visualization_.reset(new RoadmapVisualization(nh_));
+    roadmap_store_.reset(new RoadmapStore());
+    planning_contexts_.clear();
+
+    // load planner parameters, the reconfigure server reads them from the parameter server once and keeps them
+    // updated at runtime so that planning requests don't need to query the parameter server
+    ros::NodeHandle config_nh(nh_, "planner_config");
+    reconfigure_server_.reset(new dynamic_reconfigure::Server<RTRPlannerConfig>(config_nh));
+    reconfigure_server_->setCallback(boost::bind(&RTRPlannerManager::reconfigure, this, _1, _2));
+    PlannerConfig planner_config = getPlannerConfig();
+
+    // create occupancy handlers - each roadmap has its own handler so that occupancy data can be reused
+    // point cloud topics are subscribed right away so that the first planning request doesn't wait for sensor data
+    occupancy_handlers_.clear();
+    for (const std::pair<std::string, RoadmapSpecification>& roadmap : roadmaps_)
+    {
+      occupancy_handlers_[roadmap.first].reset(new OccupancyHandler(nh_));
+      if (planner_config.occupancy_source == "POINT_CLOUD" && !planner_config.pcl_topic.empty())
+        occupancy_handlers_[roadmap.first]->setPointCloudTopic(planner_config.pcl_topic);
+    }
 
     return true;
   }
@@ -194,6 +225,25 @@ public:
       // add specified roadmap names
       config.roadmap_ids.insert(group_roadmap_ids.begin(), group_roadmap_ids.end());
 
+      // load joint distance metric
+      std::string joint_distance_metric = nh_.param(group_name + "/joint_distance_metric", std::string("L1"));
+      if (joint_distance_metric == "L2")
+        config.joint_metric.type = JointDistanceMetric::L2;
+      else if (joint_distance_metric == "L_INF")
+        config.joint_metric.type = JointDistanceMetric::L_INF;
+      else if (joint_distance_metric != "L1")
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Joint distance metric of group " << group_name << " is set to unknown type '"
+                                                                         << joint_distance_metric
+                                                                         << "'. Proceeding with default 'L1'.");
+      nh_.param(group_name + "/joint_weights", config.joint_metric.weights, std::vector<float>());
+      if (std::any_of(config.joint_metric.weights.begin(), config.joint_metric.weights.end(),
+                      [](float weight) { return !(weight > 0.0); }))
+      {
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Invalid non-positive value in parameter joint_weights of group "
+                                           << group_name << ". Using default weights: 1.0");
+        config.joint_metric.weights.clear();
+      }
+
       // leave out group if no roadmap was found
       if (config.roadmap_ids.empty())
       {
@@ -291,8 +341,9 @@ public:
       auto roadmap_search = roadmaps_.find(group_roadmap);
       if (roadmap_search != roadmaps_.end())
       {
-        context.reset(
-            new RTRPlanningContext(req.group_name, roadmap_search->second, planner_interface_, visualization_));
+        context = getUnusedPlanningContext(req.group_name, roadmap_search->second, group_config);
+        context->clear();
+        context->setPlannerConfig(getPlannerConfig());
         context->setMotionPlanRequest(req);
         context->setPlanningScene(planning_scene);
         context->configure(error_code);
@@ -311,12 +362,105 @@ public:
   }
 
 private:
+  /** \brief Updates the planner parameters, this is called by the reconfigure server whenever parameters change */
+  void reconfigure(RTRPlannerConfig& config, uint32_t level)
+  {
+    PlannerConfig planner_config;
+    planner_config.allowed_joint_distance = config.allowed_joint_distance;
+    planner_config.allowed_position_distance = config.allowed_position_distance;
+    planner_config.allowed_orientation_distance = config.allowed_orientation_distance;
+    planner_config.max_waypoint_distance = config.max_waypoint_distance;
+    planner_config.max_goal_states = config.max_goal_states;
+    planner_config.goal_sample_batch_size = config.goal_sample_batch_size;
+    planner_config.quantize_roadmap_configs = config.quantize_roadmap_configs;
+    planner_config.visualization_enabled = config.visualization_enabled;
+
+    // occupancy parameters
+    if (config.occupancy_source == "PLANNING_SCENE" || config.occupancy_source == "POINT_CLOUD")
+      planner_config.occupancy_source = config.occupancy_source;
+    else
+      ROS_WARN_STREAM_NAMED(LOGNAME, "Occupancy source is set to unknown type '"
+                                         << config.occupancy_source << "'. Proceeding with default 'PLANNING_SCENE'.");
+    planner_config.pcl_topic = config.pcl_topic;
+    planner_config.pcl_max_age = config.pcl_max_age;
+    planner_config.pcl_voxelization = config.pcl_voxelization;
+    if (config.voxelization_method == "ANALYTIC")
+      planner_config.voxelization_method = OccupancyHandler::ANALYTIC;
+    else if (config.voxelization_method == "HIERARCHICAL")
+      planner_config.voxelization_method = OccupancyHandler::HIERARCHICAL;
+    else if (config.voxelization_method != "COLLISION_CHECKS")
+      ROS_WARN_STREAM_NAMED(LOGNAME, "Voxelization method is set to unknown type '"
+                                         << config.voxelization_method
+                                         << "'. Proceeding with default 'COLLISION_CHECKS'.");
+    planner_config.voxelization_threads = config.voxelization_threads;
+    planner_config.occupancy_cache_size = config.occupancy_cache_size;
+
+    std::lock_guard<std::mutex> lock(planner_config_mutex_);
+    planner_config_ = planner_config;
+  }
+
+  /** \brief Returns a copy of the current planner parameters */
+  PlannerConfig getPlannerConfig() const
+  {
+    std::lock_guard<std::mutex> lock(planner_config_mutex_);
+    return planner_config_;
+  }
+
+  /** \brief Returns a planning context of the group and roadmap that is not in use. Contexts are kept in a pool and
+   *  are reused once they have been released by the planning pipeline, a new context is only created if all contexts
+   *  are in use. New contexts are not added to the pool if it is full. Pooled contexts release their planning scene
+   *  once the returned pointer is destroyed. */
+  RTRPlanningContextPtr getUnusedPlanningContext(const std::string& group_name,
+                                                 const RoadmapSpecification& roadmap_spec,
+                                                 const GroupConfig& group_config) const
+  {
+    std::lock_guard<std::mutex> lock(planning_contexts_mutex_);
+    std::vector<RTRPlanningContextPtr>& contexts =
+        planning_contexts_[std::make_pair(group_name, roadmap_spec.roadmap_id)];
+    // the returned pointer holds a reference of the pooled context, the planning scene is released before the
+    // reference is dropped and the context is available again
+    auto hand_out = [](const RTRPlanningContextPtr& context) {
+      return RTRPlanningContextPtr(context.get(),
+                                   [context](RTRPlanningContext* /*unused*/) { context->releasePlanningScene(); });
+    };
+    for (const RTRPlanningContextPtr& context : contexts)
+    {
+      if (context.use_count() == 1)  // only referenced by the pool
+        return hand_out(context);
+    }
+
+    RoadmapSpecification group_roadmap_spec = roadmap_spec;
+    group_roadmap_spec.joint_metric = group_config.joint_metric;
+    RTRPlanningContextPtr context = std::make_shared<RTRPlanningContext>(
+        group_name, group_roadmap_spec, planner_interface_, occupancy_handlers_.at(roadmap_spec.roadmap_id),
+        roadmap_store_, visualization_);
+    if (contexts.size() >= MAX_POOLED_PLANNING_CONTEXTS)
+      return context;
+    contexts.push_back(context);
+    return hand_out(context);
+  }
+
   ros::NodeHandle nh_;
 
   // The RapidPlan wrapper interface
   RTRPlannerInterfacePtr planner_interface_;
+
+  // planner parameters, updated by the reconfigure server
+  std::unique_ptr<dynamic_reconfigure::Server<RTRPlannerConfig>> reconfigure_server_;
+  mutable std::mutex planner_config_mutex_;
+  PlannerConfig planner_config_;
   RoadmapVisualizationPtr visualization_;
 
+  // occupancy handlers by roadmap id
+  std::map<std::string, OccupancyHandlerPtr> occupancy_handlers_;
+
+  // roadmap data and search indices shared by all planning contexts
+  RoadmapStorePtr roadmap_store_;
+
+  // pool of planning contexts by group name and roadmap id
+  mutable std::mutex planning_contexts_mutex_;
+  mutable std::map<std::pair<std::string, std::string>, std::vector<RTRPlanningContextPtr>> planning_contexts_;
+
   // group and roadmap configurations
   std::vector<std::string> group_names_;
   std::map<std::string, GroupConfig> group_configs_;
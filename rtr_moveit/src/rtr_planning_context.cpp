@@ -44,9 +44,8 @@
 // Eigen
 #include <Eigen/Geometry>
 
-// ROS parameters
+// ROS
 #include <ros/ros.h>
-#include <rosparam_shortcuts/rosparam_shortcuts.h>
 #include <tf/transform_datatypes.h>
 
 // MoveIt! constraints
@@ -61,19 +60,21 @@
 #include <rtr_moveit/rtr_planner_interface.h>
 #include <rtr_moveit/occupancy_handler.h>
 #include <rtr_moveit/roadmap_search.h>
+#include <rtr_moveit/roadmap_store.h>
 #include <rtr_moveit/roadmap_visualization.h>
 
-// RapidPlan
-#include <rtr-api/OGFileReader.hpp>
-
 namespace rtr_moveit
 {
 static const std::string LOGNAME = "rtr_planning_context";
 RTRPlanningContext::RTRPlanningContext(const std::string& planning_group, const RoadmapSpecification& roadmap_spec,
                                        const RTRPlannerInterfacePtr& planner_interface,
+                                       const OccupancyHandlerPtr& occupancy_handler,
+                                       const RoadmapStorePtr& roadmap_store,
                                        const RoadmapVisualizationPtr& visualization)
   : planning_interface::PlanningContext(planning_group + "[" + roadmap_spec.roadmap_id + "]", planning_group)
   , planner_interface_(planner_interface)
+  , occupancy_handler_(occupancy_handler)
+  , roadmap_store_(roadmap_store)
   , roadmap_(roadmap_spec)
   , visualization_(visualization)
 {
@@ -95,19 +96,26 @@ moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotT
   }
 
   // extract RapidPlanGoals;
+  goals_.clear();
+  goal_states_.clear();
   if (!initRapidPlanGoals(request_.goal_constraints, goals_))
     return result;
 
-  // prepare collision scene
+  // prepare collision scene, the occupancy buffer is reused by following requests
   bool occupancy_success;
-  OccupancyData occupancy_data;
-  ros::NodeHandle nh("~");
-  OccupancyHandler occupancy_handler(nh);
-  occupancy_handler.setVolumeRegion(roadmap_.volume);
-  if (occupancy_source_ == "POINT_CLOUD")
-    occupancy_success = occupancy_handler.fromPointCloud(pcl_topic_, occupancy_data);
+  OccupancyData& occupancy_data = occupancy_data_;
+  occupancy_handler_->setVolumeRegion(roadmap_.volume);
+  occupancy_handler_->setVoxelizationMethod(config_.voxelization_method);
+  occupancy_handler_->setVoxelizationThreads(config_.voxelization_threads);
+  occupancy_handler_->setOccupancyCacheSize(config_.occupancy_cache_size);
+  if (config_.occupancy_source == "POINT_CLOUD")
+  {
+    occupancy_handler_->setPointCloudMaxAge(config_.pcl_max_age);
+    occupancy_handler_->setPointCloudVoxelization(config_.pcl_voxelization);
+    occupancy_success = occupancy_handler_->fromPointCloud(config_.pcl_topic, occupancy_data);
+  }
   else
-    occupancy_success = occupancy_handler.fromPlanningScene(planning_scene_, occupancy_data);
+    occupancy_success = occupancy_handler_->fromPlanningScene(planning_scene_, occupancy_data);
   if (!occupancy_success)
     return result;
 
@@ -116,11 +124,14 @@ moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotT
   if (!initStartState(start_state_id))
     return result;
 
+  // check roadmap collisions once, the result is used for planning with all goals
+  if (!planner_interface_->checkScene(roadmap_, occupancy_data, scene_collisions_))
+    return result;
+
   // Iterate goals and plan until we have a solution
   result.val = result.PLANNING_FAILED;
-  std::vector<rtr::Config> states;
-  std::deque<std::size_t> waypoints;
-  std::deque<std::size_t> edges;
+  std::deque<std::size_t>& waypoints = waypoints_;
+  std::deque<std::size_t>& edges = edges_;
   for (std::size_t goal_pos = 0; goal_pos < goals_.size(); goal_pos++)
   {
     // check time
@@ -133,10 +144,9 @@ moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotT
 
     // run plan
     const RapidPlanGoal& goal = goals_[goal_pos];
-    states.clear();
     waypoints.clear();
     edges.clear();
-    if (planner_interface_->solve(roadmap_, start_state_id, goal, occupancy_data, timeout, states, waypoints, edges))
+    if (planner_interface_->findPath(scene_collisions_, start_state_id, goal, timeout, waypoints, edges))
     {
       if (waypoints.empty())
       {
@@ -147,7 +157,7 @@ moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotT
       // fill solution path
       std::vector<rtr::Config> solution_path;
       for (std::size_t waypoint : waypoints)
-        solution_path.push_back(roadmap_configs_[waypoint]);
+        solution_path.push_back((*roadmap_data_->configs)[waypoint]);
 
       // convert solution path to robot trajectory
       const robot_state::RobotState& reference_state = planning_scene_->getCurrentState();
@@ -176,7 +186,7 @@ moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotT
       break;
     }
   }
-  if (visualization_enabled_)
+  if (config_.visualization_enabled)
     visualizePlanContext(occupancy_data, waypoints, result.val == result.SUCCESS);
 
   planning_time = (ros::Time::now() - start_time).toSec();
@@ -195,24 +205,26 @@ void RTRPlanningContext::visualizePlanContext(const OccupancyData& occupancy_dat
     visualization_->visualizeOccupancy(roadmap_.volume, occupancy_data);
 
   // visualize roadmap states
-  std::vector<geometry_msgs::Point> poses(roadmap_poses_.size());
-  for (std::size_t i = 0; i < roadmap_poses_.size(); ++i)
+  const std::vector<rtr::ToolPose>& roadmap_poses = roadmap_data_->poses;
+  std::vector<geometry_msgs::Point> poses(roadmap_poses.size());
+  for (std::size_t i = 0; i < roadmap_poses.size(); ++i)
   {
-    poses[i].x = roadmap_poses_[i][0];
-    poses[i].y = roadmap_poses_[i][1];
-    poses[i].z = roadmap_poses_[i][2];
+    poses[i].x = roadmap_poses[i][0];
+    poses[i].y = roadmap_poses[i][1];
+    poses[i].z = roadmap_poses[i][2];
   }
 
   // visualize roadmap edges
-  std::vector<geometry_msgs::Point> edges(2 * roadmap_edges_.size());
-  for (std::size_t i = 0; i < roadmap_edges_.size(); ++i)
+  const std::vector<rtr::EdgeInfo>& roadmap_edges = roadmap_data_->edges;
+  std::vector<geometry_msgs::Point> edges(2 * roadmap_edges.size());
+  for (std::size_t i = 0; i < roadmap_edges.size(); ++i)
   {
-    edges[2 * i].x = roadmap_poses_[roadmap_edges_[i].start_index][0];
-    edges[2 * i].y = roadmap_poses_[roadmap_edges_[i].start_index][1];
-    edges[2 * i].z = roadmap_poses_[roadmap_edges_[i].start_index][2];
-    edges[2 * i + 1].x = roadmap_poses_[roadmap_edges_[i].end_index][0];
-    edges[2 * i + 1].y = roadmap_poses_[roadmap_edges_[i].end_index][1];
-    edges[2 * i + 1].z = roadmap_poses_[roadmap_edges_[i].end_index][2];
+    edges[2 * i].x = roadmap_poses[roadmap_edges[i].start_index][0];
+    edges[2 * i].y = roadmap_poses[roadmap_edges[i].start_index][1];
+    edges[2 * i].z = roadmap_poses[roadmap_edges[i].start_index][2];
+    edges[2 * i + 1].x = roadmap_poses[roadmap_edges[i].end_index][0];
+    edges[2 * i + 1].y = roadmap_poses[roadmap_edges[i].end_index][1];
+    edges[2 * i + 1].z = roadmap_poses[roadmap_edges[i].end_index][2];
   }
   geometry_msgs::Pose pose;
   pose.orientation.w = 1.0;
@@ -224,9 +236,9 @@ void RTRPlanningContext::visualizePlanContext(const OccupancyData& occupancy_dat
     std::vector<geometry_msgs::Point> solution_poses(waypoint_ids.size());
     for (std::size_t i = 0; i < waypoint_ids.size(); ++i)
     {
-      solution_poses[i].x = roadmap_poses_[waypoint_ids[i]][0];
-      solution_poses[i].y = roadmap_poses_[waypoint_ids[i]][1];
-      solution_poses[i].z = roadmap_poses_[waypoint_ids[i]][2];
+      solution_poses[i].x = roadmap_poses[waypoint_ids[i]][0];
+      solution_poses[i].y = roadmap_poses[waypoint_ids[i]][1];
+      solution_poses[i].z = roadmap_poses[waypoint_ids[i]][2];
     }
     visualization_->visualizeSolutionPath(roadmap_.base_link_frame, pose, solution_poses);
   }
@@ -274,7 +286,7 @@ bool RTRPlanningContext::connectWaypointToTrajectory(const robot_trajectory::Rob
   // check collisions of intermediate states and the waypoint state itself
   robot_state::RobotState intermediate_state(connecting_state);
   double waypoint_distance = connecting_state.distance(*waypoint_state);
-  std::size_t step_count = std::abs(waypoint_distance / max_waypoint_distance_) + 1;
+  std::size_t step_count = std::abs(waypoint_distance / config_.max_waypoint_distance) + 1;
   double step_fraction = 1.0 / step_count;
   for (std::size_t step = 0; step <= step_count; step++)
   {
@@ -292,119 +304,81 @@ bool RTRPlanningContext::connectWaypointToTrajectory(const robot_trajectory::Rob
 void RTRPlanningContext::configure(moveit_msgs::MoveItErrorCodes& error_code)
 {
   error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+  configured_ = false;
 
-  // load defult planner parameters
-  // TODO(RTR-56): support overloading defaults
-  ros::NodeHandle nh("~");
-  std::size_t error = 0;
-  error +=
-      !rosparam_shortcuts::get(LOGNAME, nh, "planner_config/allowed_position_distance", allowed_position_distance_);
-  error += !rosparam_shortcuts::get(LOGNAME, nh, "planner_config/allowed_joint_distance", allowed_joint_distance_);
-  error += !rosparam_shortcuts::get(LOGNAME, nh, "planner_config/max_goal_states", max_goal_states_);
-  error += !rosparam_shortcuts::get(LOGNAME, nh, "planner_config/max_waypoint_distance", max_waypoint_distance_);
-  if (error)
+  // planning scene should be set
+  if (!planning_scene_)
   {
-    ROS_ERROR_NAMED(LOGNAME, "Planning Context could not be configured due to missing params");
+    ROS_ERROR_NAMED(LOGNAME, "Cannot configure planning context while planning scene has not been set");
     return;
   }
 
-  // read occupancy parameters
-  nh.param("planner_config/occupancy_source", occupancy_source_, std::string("PLANNING_SCENE"));
-  nh.param("planner_config/visualization_enabled", visualization_enabled_, false);
-  if (occupancy_source_ != "PLANNING_SCENE")
-  {
-    if (occupancy_source_ != "POINT_CLOUD")
-    {
-      ROS_WARN_STREAM_NAMED(LOGNAME, "Occupancy source is set to unknown type '"
-                                         << occupancy_source_ << "'. Proceeding with default 'PLANNING_SCENE'.");
-      occupancy_source_ = "PLANNING_SCENE";
-    }
-    else if (!nh.getParam("planner_config/pcl_topic", pcl_topic_))
-    {
-      ROS_ERROR_NAMED(LOGNAME, "Occupancy source 'POINT_CLOUD' cannot be configured without parameter 'pcl_topic'");
-      return;
-    }
-  }
-
-  // planning scene should be set
-  if (!planning_scene_)
+  // check occupancy parameters
+  if (config_.occupancy_source == "POINT_CLOUD" && config_.pcl_topic.empty())
   {
-    ROS_ERROR_NAMED(LOGNAME, "Cannot configure planning context while planning scene has not been set");
+    ROS_ERROR_NAMED(LOGNAME, "Occupancy source 'POINT_CLOUD' cannot be configured without parameter 'pcl_topic'");
     return;
   }
 
   // get joint model group
-  jmg_ = planning_scene_->getCurrentState().getJointModelGroup(group_);
-  joint_model_names_ = jmg_->getActiveJointModelNames();
+  if (!jmg_)
+  {
+    jmg_ = planning_scene_->getCurrentState().getJointModelGroup(group_);
+    joint_model_names_ = jmg_->getActiveJointModelNames();
+  }
 
   // check planner interface
   if (!planner_interface_->isReady() && !planner_interface_->initialize())
     return;
 
-  // read roadmap data from .og file
-  og_file_.reset(new rtr::OGFileReader(roadmap_.og_file));
-  if (!og_file_->IsValid())
-  {
-    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file invalid " << roadmap_.og_file << "'");
+  // get roadmap data, the roadmap file is only parsed once and its data is shared by all planning contexts
+  RoadmapDataConstPtr roadmap_data = roadmap_store_->getRoadmap(roadmap_);
+  if (!roadmap_data)
     return;
-  }
-
-  // get roadmap configs
-  if (!og_file_->GetConfigs(roadmap_configs_) || roadmap_configs_.empty())
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load config states from roadmap file");
+  if (roadmap_data != roadmap_data_ && !initRoadmap(roadmap_data))
     return;
-  }
+
+  // get search index of roadmap configs, the index is only built once per roadmap and quantization setting
+  if (!config_index_ || config_index_->getConfigs() != roadmap_data_->configs ||
+      config_index_->isQuantized() != config_.quantize_roadmap_configs)
+    config_index_ =
+        roadmap_store_->getConfigIndex(roadmap_.roadmap_id, roadmap_data_, config_.quantize_roadmap_configs);
+
+  // done
+  error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  configured_ = true;
+}
+
+bool RTRPlanningContext::initRoadmap(const RoadmapDataConstPtr& roadmap_data)
+{
+  // the roadmap data is only replaced on success, so that invalid roadmaps are checked again with the next request
+  const std::size_t dimension = roadmap_data->configs->front().size();
 
   // check if joint dimension in roadmap fits to joint model group
-  if (roadmap_configs_[0].size() != joint_model_names_.size())
+  if (dimension != joint_model_names_.size())
   {
     ROS_ERROR_NAMED(LOGNAME, "Roadmap state dimension does not fit to joint count of planning group");
-    return;
-  }
-
-  // get roadmap poses
-  if (!og_file_->GetPoses(roadmap_poses_) || roadmap_poses_.empty())
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load state poses from roadmap file");
-    return;
+    return false;
   }
 
-  // get roadmap edges
-  if (!og_file_->GetEdges(roadmap_edges_) || roadmap_edges_.empty())
+  // check joint weights of the distance metric, missing weights are filled in so that the joint dimension is known
+  // when fixed DOF edge cost functions are selected
+  if (!roadmap_.joint_metric.weights.empty() && roadmap_.joint_metric.weights.size() != dimension)
   {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load state edges from roadmap file");
-    return;
+    ROS_WARN_NAMED(LOGNAME, "Number of joint weights does not fit to joint count of planning group. Using default "
+                            "weights: 1.0");
+    roadmap_.joint_metric.weights.clear();
   }
+  roadmap_.joint_metric.weights = roadmap_.joint_metric.getWeights(dimension);
+  roadmap_.volume = roadmap_data->volume;
+  roadmap_.base_link_frame = roadmap_data->base_link_frame;
+  roadmap_.end_effector_frame = roadmap_data->end_effector_frame;
 
-  // load occupancy region volume
-  rtr::ToolPose volume_center_pose;
-  if (!og_file_->GetVoxelRegion(roadmap_.volume.pose.header.frame_id, volume_center_pose, roadmap_.volume.dimension))
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load voxel region from roadmap file");
-    return;
-  }
-  roadmap_.volume.pose.pose.position.x = volume_center_pose[0];
-  roadmap_.volume.pose.pose.position.y = volume_center_pose[1];
-  roadmap_.volume.pose.pose.position.z = volume_center_pose[2];
-  roadmap_.volume.pose.pose.orientation =
-      tf::createQuaternionMsgFromRollPitchYaw(volume_center_pose[3], volume_center_pose[4], volume_center_pose[5]);
-  roadmap_.volume.pose.header.frame_id = "world";  // NOTE: GetVoxelRegion returns an empty frame - we fix this here
-  if (!og_file_->GetResolution(roadmap_.volume.voxel_resolution))
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Failed to read volume voxel resolution from roadmap file");
-    return;
-  }
-  std::array<float, 6> start_link_transform;
-  if (!og_file_->GetKinematicData(start_link_transform, roadmap_.base_link_frame, roadmap_.end_effector_frame))
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Failed to read kinematic data roadmap file");
-    return;
-  }
+  // get search index of roadmap poses, the index is only built once per roadmap
+  pose_index_ = roadmap_store_->getPoseIndex(roadmap_.roadmap_id, roadmap_data);
 
-  // done
-  error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
-  configured_ = true;
+  roadmap_data_ = roadmap_data;
+  return true;
 }
 
 bool RTRPlanningContext::initRapidPlanGoals(const std::vector<moveit_msgs::Constraints>& goal_constraints,
@@ -457,32 +431,152 @@ bool RTRPlanningContext::getRapidPlanGoal(const moveit_msgs::Constraints& goal_c
     samplers.push_back(ik_sampler);
   }
 
+  // goal state candidates of pose goals are restricted to roadmap states within the allowed pose distance
+  rtr::ToolPose goal_pose;
+  float position_tolerance, orientation_tolerance;
+  std::vector<std::size_t> pose_state_ids;
+  ConfigStore pose_state_store;
+  if (getGoalToolPose(goal_constraint, goal_pose, position_tolerance, orientation_tolerance))
+  {
+    std::vector<float> position_distances;
+    pose_index_->findWithinTolerance(goal_pose, pose_state_ids, position_distances, position_tolerance,
+                                     orientation_tolerance);
+    if (pose_state_ids.empty())
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Unable to find goal state candidates in the roadmap within the allowed pose distance");
+      return false;
+    }
+    std::vector<rtr::Config> pose_state_configs;
+    pose_state_configs.reserve(pose_state_ids.size());
+    for (std::size_t state_id : pose_state_ids)
+      pose_state_configs.push_back((*roadmap_data_->configs)[state_id]);
+    pose_state_store = ConfigStore(pose_state_configs);
+  }
+
   // sample goal from roadmap states
   constraint_samplers::UnionConstraintSampler union_sampler(planning_scene_, group_, samplers);
   const robot_state::RobotState& robot_state = planning_scene_->getCurrentState();
   robot_state::RobotState sample_state(robot_state);
   std::vector<double> joint_positions(jmg_->getActiveJointModels().size());
-  rtr::Config sample_config(joint_positions.size());
-  std::vector<float> distances;
+  std::vector<robot_state::RobotState> sample_states;
+  std::vector<rtr::Config> sample_configs;
+  std::vector<std::vector<std::size_t>> state_ids;
+  std::vector<std::vector<float>> distances;
+
+  // search goal state candidates of a batch of samples within allowed joint distance, the sample with the closest
+  // roadmap state is used as goal
+  auto search_samples = [&]() {
+    if (pose_state_ids.empty())
+    {
+      config_index_->findClosestBatch(sample_configs, state_ids, distances, config_.max_goal_states,
+                                      config_.allowed_joint_distance, roadmap_.joint_metric);
+    }
+    else
+    {
+      pose_state_store.findClosestBatch(sample_configs, state_ids, distances, config_.max_goal_states,
+                                        config_.allowed_joint_distance, roadmap_.joint_metric);
+      for (std::vector<std::size_t>& sample_state_ids : state_ids)
+        for (std::size_t& state_id : sample_state_ids)
+          state_id = pose_state_ids[state_id];
+    }
+    const std::size_t num_samples = sample_configs.size();
+    std::size_t best_sample = num_samples;
+    for (std::size_t i = 0; i < num_samples; ++i)
+      if (!state_ids[i].empty() && (best_sample == num_samples || distances[i][0] < distances[best_sample][0]))
+        best_sample = i;
+    if (best_sample < num_samples)
+    {
+      goal.state_ids = state_ids[best_sample];
+      goal_state = std::make_shared<robot_state::RobotState>(sample_states[best_sample]);
+    }
+    sample_states.clear();
+    sample_configs.clear();
+    return best_sample < num_samples;
+  };
+
+  std::size_t num_seeds = 0;
   while (ros::Time::now() < terminate_plan_time_)
   {
-    if (!union_sampler.sample(sample_state, robot_state, 100))
-      continue;
+    if (pose_state_ids.empty())
+    {
+      if (!union_sampler.sample(sample_state, robot_state, 100))
+        continue;
+    }
+    else
+    {
+      // seed samples with the goal state candidates so that IK solutions are close to the roadmap states
+      const rtr::Config& seed_config = (*roadmap_data_->configs)[pose_state_ids[num_seeds++ % pose_state_ids.size()]];
+      joint_positions.assign(seed_config.begin(), seed_config.end());
+      sample_state.setJointGroupPositions(jmg_, joint_positions);
+      if (!union_sampler.project(sample_state, 100))
+        continue;
+    }
     sample_state.copyJointGroupPositions(group_, joint_positions);
+    sample_states.push_back(sample_state);
     // copy joint values to rtr::Config
-    std::transform(std::begin(joint_positions), std::end(joint_positions), std::begin(sample_config),
-                   [](double d) -> float { return float(d); });
-    // search for goal state candidates within allowed joint distance
-    // TODO(RTR-7): (pre-)filter by allowed position distance
-    findClosestConfigs(sample_config, roadmap_configs_, goal.state_ids, distances, max_goal_states_,
-                       allowed_joint_distance_);
-    if (!goal.state_ids.empty())
-    {
-      goal_state = std::make_shared<robot_state::RobotState>(sample_state);
+    sample_configs.emplace_back(joint_positions.begin(), joint_positions.end());
+    if (sample_configs.size() >= static_cast<std::size_t>(config_.goal_sample_batch_size) && search_samples())
       return true;
-    }
   }
-  return false;
+  // search remaining samples of an incomplete batch
+  return !sample_configs.empty() && search_samples();
+}
+
+bool RTRPlanningContext::getGoalToolPose(const moveit_msgs::Constraints& goal_constraint, rtr::ToolPose& tool_pose,
+                                         float& position_tolerance, float& orientation_tolerance) const
+{
+  // only goals with a single position and/or orientation constraint of the roadmap end effector are supported
+  const std::vector<moveit_msgs::PositionConstraint>& position_constraints = goal_constraint.position_constraints;
+  const std::vector<moveit_msgs::OrientationConstraint>& orientation_constraints =
+      goal_constraint.orientation_constraints;
+  if ((position_constraints.empty() && orientation_constraints.empty()) || position_constraints.size() > 1 ||
+      orientation_constraints.size() > 1)
+    return false;
+
+  // roadmap tool poses are given relative to the base link
+  // we use auto to support Affine3d and Isometry3d (kinetic + melodic)
+  auto base_to_world(planning_scene_->getFrameTransform(roadmap_.base_link_frame).inverse());
+  Eigen::Vector3d position = Eigen::Vector3d::Zero();
+  Eigen::Quaterniond orientation = Eigen::Quaterniond::Identity();
+  position_tolerance = FLT_MAX;
+  orientation_tolerance = FLT_MAX;
+  if (!position_constraints.empty())
+  {
+    const moveit_msgs::PositionConstraint& constraint = position_constraints[0];
+    const geometry_msgs::Vector3& offset = constraint.target_point_offset;
+    if (constraint.link_name != roadmap_.end_effector_frame || constraint.constraint_region.primitive_poses.empty() ||
+        offset.x != 0.0 || offset.y != 0.0 || offset.z != 0.0)
+      return false;
+    const geometry_msgs::Point& point = constraint.constraint_region.primitive_poses[0].position;
+    position = base_to_world * planning_scene_->getFrameTransform(constraint.header.frame_id) *
+               Eigen::Vector3d(point.x, point.y, point.z);
+    position_tolerance = config_.allowed_position_distance;
+  }
+  if (!orientation_constraints.empty())
+  {
+    const moveit_msgs::OrientationConstraint& constraint = orientation_constraints[0];
+    if (constraint.link_name != roadmap_.end_effector_frame)
+      return false;
+    const geometry_msgs::Quaternion& quaternion = constraint.orientation;
+    orientation = Eigen::Quaterniond(base_to_world.rotation() *
+                                     planning_scene_->getFrameTransform(constraint.header.frame_id).rotation() *
+                                     Eigen::Quaterniond(quaternion.w, quaternion.x, quaternion.y, quaternion.z)
+                                         .normalized()
+                                         .toRotationMatrix());
+    orientation_tolerance = config_.allowed_orientation_distance;
+  }
+
+  // convert to rtr::ToolPose with roll, pitch, yaw orientation
+  double roll, pitch, yaw;
+  tf::Matrix3x3(tf::Quaternion(orientation.x(), orientation.y(), orientation.z(), orientation.w()))
+      .getRPY(roll, pitch, yaw);
+  tool_pose[0] = position.x();
+  tool_pose[1] = position.y();
+  tool_pose[2] = position.z();
+  tool_pose[3] = roll;
+  tool_pose[4] = pitch;
+  tool_pose[5] = yaw;
+  return true;
 }
 
 bool RTRPlanningContext::initStartState(std::size_t& start_state_id)
@@ -519,7 +613,7 @@ bool RTRPlanningContext::initStartState(std::size_t& start_state_id)
   }
 
   // search for start state candidate in roadmap
-  int result_id = findClosestConfigId(start_config, roadmap_configs_, allowed_joint_distance_);
+  int result_id = config_index_->findClosestId(start_config, config_.allowed_joint_distance, roadmap_.joint_metric);
   if (result_id < 0)
     ROS_ERROR_NAMED(LOGNAME, "Unable to find a start state candidate in the roadmap within the allowed joint distance");
   start_state_id = result_id;
@@ -528,7 +622,22 @@ bool RTRPlanningContext::initStartState(std::size_t& start_state_id)
 
 void RTRPlanningContext::clear()
 {
-  // TODO(henningkayser): implement and support reusing planning contexts
+  // reset request data, roadmap data, search indices and buffers are kept for reusing the context
+  request_ = planning_interface::MotionPlanRequest();
+  planning_scene_.reset();
+  start_state_.reset();
+  goal_states_.clear();
+  goals_.clear();
+  occupancy_data_.point_cloud.reset();
+  configured_ = false;
+}
+
+void RTRPlanningContext::releasePlanningScene()
+{
+  // the request is kept, but the context needs to be configured with a new planning scene before solving again
+  planning_scene_.reset();
+  occupancy_data_.point_cloud.reset();
+  configured_ = false;
 }
 
 bool RTRPlanningContext::terminate()
@@ -0,0 +1,487 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Author: Henning Kayser
+ * Desc: Analytic voxelization of collision shapes inside a roadmap volume region
+ */
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// SIMD
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// OctoMap
+#include <octomap/octomap.h>
+
+// rtr_moveit
+#include <rtr_moveit/voxelization.h>
+
+namespace rtr_moveit
+{
+namespace
+{
+// tolerance that prevents false separations along degenerate axes in the separating axis tests
+constexpr double SAT_EPSILON = 1e-9;
+
+/** Returns the voxel box dimensions of the volume region grid
+ *  NOTE: voxel dimensions are computed with float precision to match the collision check implementation */
+Eigen::Vector3d getVoxelDimensions(const RoadmapVolume& volume)
+{
+  return Eigen::Vector3d(volume.dimension[0] / float(volume.voxel_resolution[0]),
+                         volume.dimension[1] / float(volume.voxel_resolution[1]),
+                         volume.dimension[2] / float(volume.voxel_resolution[2]));
+}
+
+/** Computes the voxel bounds of all grid cells overlapping an axis-aligned box given in volume coordinates */
+bool getVoxelBounds(const Eigen::Vector3d& box_min, const Eigen::Vector3d& box_max, const RoadmapVolume& volume,
+                    VoxelBounds& bounds)
+{
+  const Eigen::Vector3d voxel_dimensions = getVoxelDimensions(volume);
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    // voxel i covers the interval [i * voxel_dimension, (i + 1) * voxel_dimension]
+    double min_index = std::max(std::floor(box_min[i] / voxel_dimensions[i]), 0.0);
+    double max_index = std::min(std::ceil(box_max[i] / voxel_dimensions[i]) - 1.0, volume.voxel_resolution[i] - 1.0);
+    if (volume.voxel_resolution[i] == 0 || !(min_index <= max_index))
+      return false;
+    bounds.min[i] = min_index;
+    bounds.max[i] = max_index;
+  }
+  return true;
+}
+
+/** Computes the voxel bounds of an oriented box with given center pose and half extents */
+bool getOrientedBoxVoxelBounds(const Eigen::Affine3d& box_pose, const Eigen::Vector3d& half_extents,
+                               const RoadmapVolume& volume, VoxelBounds& bounds)
+{
+  const Eigen::Vector3d aabb_half_extents = box_pose.linear().cwiseAbs() * half_extents;
+  return getVoxelBounds(box_pose.translation() - aabb_half_extents, box_pose.translation() + aabb_half_extents,
+                        volume, bounds);
+}
+
+/** Separating axis test between an axis-aligned voxel box and an oriented box
+ * (see Ericson, "Real-Time Collision Detection", 4.4.1) */
+bool intersectsOrientedBox(const Eigen::Vector3d& voxel_center, const Eigen::Vector3d& voxel_half_extents,
+                           const Eigen::Affine3d& box_pose, const Eigen::Vector3d& box_half_extents)
+{
+  const Eigen::Matrix3d& rotation = box_pose.linear();
+  const Eigen::Matrix3d abs_rotation = rotation.cwiseAbs().array() + SAT_EPSILON;
+  const Eigen::Vector3d distance = box_pose.translation() - voxel_center;
+
+  // voxel axes
+  for (std::size_t i = 0; i < 3; ++i)
+    if (std::abs(distance[i]) >= voxel_half_extents[i] + abs_rotation.row(i).dot(box_half_extents))
+      return false;
+
+  // box axes
+  for (std::size_t j = 0; j < 3; ++j)
+    if (std::abs(distance.dot(rotation.col(j))) >= voxel_half_extents.dot(abs_rotation.col(j)) + box_half_extents[j])
+      return false;
+
+  // cross products of voxel and box axes
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    std::size_t i1 = (i + 1) % 3;
+    std::size_t i2 = (i + 2) % 3;
+    for (std::size_t j = 0; j < 3; ++j)
+    {
+      std::size_t j1 = (j + 1) % 3;
+      std::size_t j2 = (j + 2) % 3;
+      double radius_voxel = voxel_half_extents[i1] * abs_rotation(i2, j) + voxel_half_extents[i2] * abs_rotation(i1, j);
+      double radius_box = box_half_extents[j1] * abs_rotation(i, j2) + box_half_extents[j2] * abs_rotation(i, j1);
+      if (std::abs(distance[i2] * rotation(i1, j) - distance[i1] * rotation(i2, j)) >= radius_voxel + radius_box)
+        return false;
+    }
+  }
+  return true;
+}
+
+/** Separating axis test between an axis-aligned voxel box and a triangle
+ * (see Akenine-Moeller, "Fast 3D Triangle-Box Overlap Testing") */
+bool intersectsTriangle(const Eigen::Vector3d& voxel_center, const Eigen::Vector3d& voxel_half_extents,
+                        const Eigen::Vector3d& a, const Eigen::Vector3d& b, const Eigen::Vector3d& c)
+{
+  // triangle vertices relative to the voxel center
+  const std::array<Eigen::Vector3d, 3> vertices = { { a - voxel_center, b - voxel_center, c - voxel_center } };
+  const std::array<Eigen::Vector3d, 3> edges = { { vertices[1] - vertices[0], vertices[2] - vertices[1],
+                                                   vertices[0] - vertices[2] } };
+
+  // projects the triangle onto an axis and checks if it is separated from the voxel projection
+  auto is_separating_axis = [&](const Eigen::Vector3d& axis) {
+    double p0 = axis.dot(vertices[0]);
+    double p1 = axis.dot(vertices[1]);
+    double p2 = axis.dot(vertices[2]);
+    double radius = voxel_half_extents.dot(axis.cwiseAbs());
+    return std::min({ p0, p1, p2 }) >= radius || std::max({ p0, p1, p2 }) <= -radius;
+  };
+
+  // voxel face normals
+  for (std::size_t i = 0; i < 3; ++i)
+    if (is_separating_axis(Eigen::Vector3d::Unit(i)))
+      return false;
+
+  // triangle normal
+  const Eigen::Vector3d normal = edges[0].cross(edges[1]);
+  if (normal.squaredNorm() > SAT_EPSILON && is_separating_axis(normal))
+    return false;
+
+  // cross products of voxel axes and triangle edges
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (const Eigen::Vector3d& edge : edges)
+    {
+      const Eigen::Vector3d axis = Eigen::Vector3d::Unit(i).cross(edge);
+      if (axis.squaredNorm() > SAT_EPSILON && is_separating_axis(axis))
+        return false;
+    }
+  }
+  return true;
+}
+
+/** Calls visit(x, y, z, voxel_center) for all voxels inside the given bounds */
+template <typename Visitor>
+void forEachVoxel(const VoxelBounds& bounds, const Eigen::Vector3d& voxel_dimensions, Visitor visit)
+{
+  for (uint16_t x = bounds.min[0]; x <= bounds.max[0]; ++x)
+    for (uint16_t y = bounds.min[1]; y <= bounds.max[1]; ++y)
+      for (uint16_t z = bounds.min[2]; z <= bounds.max[2]; ++z)
+        visit(x, y, z, Eigen::Vector3d((x + 0.5) * voxel_dimensions[0], (y + 0.5) * voxel_dimensions[1],
+                                       (z + 0.5) * voxel_dimensions[2]));
+}
+
+void voxelizeOrientedBox(const Eigen::Affine3d& box_pose, const Eigen::Vector3d& half_extents,
+                         const RoadmapVolume& volume, OccupancyGrid& occupied)
+{
+  const Eigen::Vector3d voxel_dimensions = getVoxelDimensions(volume);
+  const Eigen::Vector3d voxel_half_extents = 0.5 * voxel_dimensions;
+  VoxelBounds bounds;
+  if (!getOrientedBoxVoxelBounds(box_pose, half_extents, volume, bounds))
+    return;
+  forEachVoxel(bounds, voxel_dimensions, [&](uint16_t x, uint16_t y, uint16_t z, const Eigen::Vector3d& center) {
+    std::size_t index = occupied.getIndex(x, y, z);
+    if (!occupied.test(index) && intersectsOrientedBox(center, voxel_half_extents, box_pose, half_extents))
+      occupied.set(index);
+  });
+}
+
+void voxelizeBox(const shapes::Box& box, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                 OccupancyGrid& occupied)
+{
+  voxelizeOrientedBox(shape_pose, 0.5 * Eigen::Vector3d(box.size[0], box.size[1], box.size[2]), volume, occupied);
+}
+
+void voxelizeOcTree(const shapes::OcTree& octree, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                    OccupancyGrid& occupied)
+{
+  if (!octree.octree)
+    return;
+  const octomap::OcTree& tree = *octree.octree;
+
+  // only iterate leaves inside the bounding box of the volume region given in octree coordinates
+  const Eigen::Affine3d volume_pose(shape_pose.inverse());
+  const Eigen::Vector3d volume_half_extents =
+      0.5 * Eigen::Vector3d(volume.dimension[0], volume.dimension[1], volume.dimension[2]);
+  const Eigen::Vector3d volume_center = volume_pose * volume_half_extents;
+  const Eigen::Vector3d volume_aabb_half_extents = volume_pose.linear().cwiseAbs() * volume_half_extents;
+  const Eigen::Vector3d bbx_min = volume_center - volume_aabb_half_extents;
+  const Eigen::Vector3d bbx_max = volume_center + volume_aabb_half_extents;
+
+  // rasterize occupied leaves as boxes, leaves can be larger or smaller than voxels
+  Eigen::Affine3d leaf_pose(shape_pose);
+  for (auto leaf = tree.begin_leafs_bbx(octomap::point3d(bbx_min.x(), bbx_min.y(), bbx_min.z()),
+                                        octomap::point3d(bbx_max.x(), bbx_max.y(), bbx_max.z()));
+       leaf != tree.end_leafs_bbx(); ++leaf)
+  {
+    if (!tree.isNodeOccupied(*leaf))
+      continue;
+    leaf_pose.translation() = shape_pose * Eigen::Vector3d(leaf.getX(), leaf.getY(), leaf.getZ());
+    voxelizeOrientedBox(leaf_pose, Eigen::Vector3d::Constant(0.5 * leaf.getSize()), volume, occupied);
+  }
+}
+
+void voxelizeSphere(const shapes::Sphere& sphere, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                    OccupancyGrid& occupied)
+{
+  const Eigen::Vector3d& sphere_center = shape_pose.translation();
+  const Eigen::Vector3d radius = Eigen::Vector3d::Constant(sphere.radius);
+  const Eigen::Vector3d voxel_dimensions = getVoxelDimensions(volume);
+  const Eigen::Vector3d voxel_half_extents = 0.5 * voxel_dimensions;
+  VoxelBounds bounds;
+  if (!getVoxelBounds(sphere_center - radius, sphere_center + radius, volume, bounds))
+    return;
+  double squared_radius = sphere.radius * sphere.radius;
+  forEachVoxel(bounds, voxel_dimensions, [&](uint16_t x, uint16_t y, uint16_t z, const Eigen::Vector3d& center) {
+    // distance of the closest voxel point to the sphere center
+    Eigen::Vector3d closest_point =
+        sphere_center.cwiseMax(center - voxel_half_extents).cwiseMin(center + voxel_half_extents);
+    if ((closest_point - sphere_center).squaredNorm() < squared_radius)
+      occupied.set(x, y, z);
+  });
+}
+
+void voxelizeMesh(const shapes::Mesh& mesh, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                  OccupancyGrid& occupied)
+{
+  const Eigen::Vector3d voxel_dimensions = getVoxelDimensions(volume);
+  const Eigen::Vector3d voxel_half_extents = 0.5 * voxel_dimensions;
+
+  // transform vertices into volume coordinates
+  std::vector<Eigen::Vector3d> vertices(mesh.vertex_count);
+  for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    vertices[i] =
+        shape_pose * Eigen::Vector3d(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+
+  // rasterize triangles separately, only voxels overlapping the triangle bounding box are tested
+  VoxelBounds bounds;
+  for (unsigned int i = 0; i < mesh.triangle_count; ++i)
+  {
+    const Eigen::Vector3d& a = vertices[mesh.triangles[3 * i]];
+    const Eigen::Vector3d& b = vertices[mesh.triangles[3 * i + 1]];
+    const Eigen::Vector3d& c = vertices[mesh.triangles[3 * i + 2]];
+    if (!getVoxelBounds(a.cwiseMin(b).cwiseMin(c), a.cwiseMax(b).cwiseMax(c), volume, bounds))
+      continue;
+    forEachVoxel(bounds, voxel_dimensions, [&](uint16_t x, uint16_t y, uint16_t z, const Eigen::Vector3d& center) {
+      std::size_t index = occupied.getIndex(x, y, z);
+      if (!occupied.test(index) && intersectsTriangle(center, voxel_half_extents, a, b, c))
+        occupied.set(index);
+    });
+  }
+}
+
+/** Transforms points into voxel coordinates and marks the grid cells of all points inside the grid.
+ *  Cells are marked with unconditional byte stores, a bitset would require read-modify-write chains that stall on
+ *  dense clouds where consecutive points hit the same cells.
+ * @param points - the points to bin
+ * @param num_points - the number of points
+ * @param to_voxel - the affine transform from point coordinates to (continuous) voxel coordinates
+ * @param resolution - the voxel resolution of the grid
+ * @param grid - the grid cells of size x*y*z + 1, the last cell collects all points outside the grid
+ */
+void binPoints(const pcl::PointXYZ* points, std::size_t num_points, const Eigen::Matrix<float, 3, 4>& to_voxel,
+               const std::array<uint16_t, 3>& resolution, std::vector<uint8_t>& grid)
+{
+  const float res_x = resolution[0];
+  const float res_y = resolution[1];
+  const float res_z = resolution[2];
+  const std::size_t stride_x = std::size_t(resolution[1]) * resolution[2];
+  const std::size_t stride_y = resolution[2];
+  const std::size_t num_voxels = stride_x * resolution[0];
+  std::size_t i = 0;
+
+#ifdef __AVX2__
+  // process 8 points at once, points are stored as xyz + padding so 4 loads and a transpose give x/y/z vectors
+  // linear indices are computed with 32 bit integers which is sufficient for all practical grid sizes
+  const std::size_t num_simd_points = num_voxels < std::size_t(std::numeric_limits<int32_t>::max()) ? num_points : 0;
+  __m256 m[3][4];
+  for (std::size_t row = 0; row < 3; ++row)
+    for (std::size_t col = 0; col < 4; ++col)
+      m[row][col] = _mm256_set1_ps(to_voxel(row, col));
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 res[3] = { _mm256_set1_ps(res_x), _mm256_set1_ps(res_y), _mm256_set1_ps(res_z) };
+  const __m256i stride_x_vec = _mm256_set1_epi32(stride_x);
+  const __m256i stride_y_vec = _mm256_set1_epi32(stride_y);
+  const __m256i outside_index = _mm256_set1_epi32(num_voxels);
+  __m256i indices[3];
+  for (; i + 8 <= num_simd_points; i += 8)
+  {
+    const pcl::PointXYZ* p = points + i;
+    __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[0].data)), _mm_loadu_ps(p[4].data), 1);
+    __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[1].data)), _mm_loadu_ps(p[5].data), 1);
+    __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[2].data)), _mm_loadu_ps(p[6].data), 1);
+    __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[3].data)), _mm_loadu_ps(p[7].data), 1);
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);  // x0 x1 y0 y1 | x4 x5 y4 y5
+    __m256 t1 = _mm256_unpacklo_ps(r2, r3);  // x2 x3 y2 y3 | x6 x7 y6 y7
+    __m256 t2 = _mm256_unpackhi_ps(r0, r1);  // z0 z1 -- -- | z4 z5 -- --
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);  // z2 z3 -- -- | z6 z7 -- --
+    const __m256 x = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 z = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+
+    // transform and crop, ordered comparisons also reject NaN points
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (std::size_t row = 0; row < 3; ++row)
+    {
+      __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[row][0], x), _mm256_mul_ps(m[row][1], y)),
+                                             _mm256_mul_ps(m[row][2], z)),
+                               m[row][3]);
+      inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ),
+                                                   _mm256_cmp_ps(v, res[row], _CMP_LT_OQ)));
+      indices[row] = _mm256_cvttps_epi32(v);
+    }
+
+    // mark cells without branches, points outside the grid mark the last cell
+    const __m256i index = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_mullo_epi32(indices[0], stride_x_vec), _mm256_mullo_epi32(indices[1], stride_y_vec)),
+        indices[2]);
+    alignas(32) int32_t lane_indices[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane_indices),
+                       _mm256_blendv_epi8(outside_index, index, _mm256_castps_si256(inside)));
+    for (int lane = 0; lane < 8; ++lane)
+      grid[lane_indices[lane]] = 1;
+  }
+#endif
+
+  // scalar implementation, evaluates the transform in the same order as the vectorized one
+  for (; i < num_points; ++i)
+  {
+    const float* p = points[i].data;
+    float v[3];
+    for (std::size_t row = 0; row < 3; ++row)
+      v[row] = to_voxel(row, 0) * p[0] + to_voxel(row, 1) * p[1] + to_voxel(row, 2) * p[2] + to_voxel(row, 3);
+    const bool inside = v[0] >= 0.0f && v[0] < res_x && v[1] >= 0.0f && v[1] < res_y && v[2] >= 0.0f && v[2] < res_z;
+    grid[inside ? std::size_t(v[0]) * stride_x + std::size_t(v[1]) * stride_y + std::size_t(v[2]) : num_voxels] = 1;
+  }
+}
+}  // namespace
+
+bool getShapeVoxelBounds(const shapes::Shape& shape, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                         VoxelBounds& bounds)
+{
+  switch (shape.type)
+  {
+    case shapes::BOX:
+    {
+      const double* size = static_cast<const shapes::Box&>(shape).size;
+      return getOrientedBoxVoxelBounds(shape_pose, 0.5 * Eigen::Vector3d(size[0], size[1], size[2]), volume, bounds);
+    }
+    case shapes::SPHERE:
+    {
+      const Eigen::Vector3d radius = Eigen::Vector3d::Constant(static_cast<const shapes::Sphere&>(shape).radius);
+      return getVoxelBounds(shape_pose.translation() - radius, shape_pose.translation() + radius, volume, bounds);
+    }
+    case shapes::CYLINDER:
+    {
+      const shapes::Cylinder& cylinder = static_cast<const shapes::Cylinder&>(shape);
+      return getOrientedBoxVoxelBounds(shape_pose, Eigen::Vector3d(cylinder.radius, cylinder.radius,
+                                                                   0.5 * cylinder.length),
+                                       volume, bounds);
+    }
+    case shapes::CONE:
+    {
+      const shapes::Cone& cone = static_cast<const shapes::Cone&>(shape);
+      return getOrientedBoxVoxelBounds(shape_pose, Eigen::Vector3d(cone.radius, cone.radius, 0.5 * cone.length),
+                                       volume, bounds);
+    }
+    case shapes::MESH:
+    {
+      const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(shape);
+      if (mesh.vertex_count == 0)
+        return false;
+      Eigen::Vector3d mesh_min = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+      Eigen::Vector3d mesh_max = Eigen::Vector3d::Constant(-std::numeric_limits<double>::max());
+      for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+      {
+        Eigen::Vector3d vertex =
+            shape_pose * Eigen::Vector3d(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+        mesh_min = mesh_min.cwiseMin(vertex);
+        mesh_max = mesh_max.cwiseMax(vertex);
+      }
+      return getVoxelBounds(mesh_min, mesh_max, volume, bounds);
+    }
+    case shapes::OCTREE:
+    {
+      const shapes::OcTree& octree = static_cast<const shapes::OcTree&>(shape);
+      if (!octree.octree)
+        return false;
+      double min_x, min_y, min_z, max_x, max_y, max_z;
+      octree.octree->getMetricMin(min_x, min_y, min_z);
+      octree.octree->getMetricMax(max_x, max_y, max_z);
+      Eigen::Affine3d octree_center_pose(shape_pose);
+      octree_center_pose.translation() = shape_pose * Eigen::Vector3d(0.5 * (min_x + max_x), 0.5 * (min_y + max_y),
+                                                                      0.5 * (min_z + max_z));
+      return getOrientedBoxVoxelBounds(
+          octree_center_pose, 0.5 * Eigen::Vector3d(max_x - min_x, max_y - min_y, max_z - min_z), volume, bounds);
+    }
+    default:
+      // unbounded or unknown shapes potentially cover the whole volume
+      return getVoxelBounds(Eigen::Vector3d::Zero(),
+                            Eigen::Vector3d(volume.dimension[0], volume.dimension[1], volume.dimension[2]), volume,
+                            bounds);
+  }
+}
+
+bool voxelizeShape(const shapes::Shape& shape, const Eigen::Affine3d& shape_pose, const RoadmapVolume& volume,
+                   OccupancyGrid& occupied)
+{
+  switch (shape.type)
+  {
+    case shapes::BOX:
+      voxelizeBox(static_cast<const shapes::Box&>(shape), shape_pose, volume, occupied);
+      return true;
+    case shapes::SPHERE:
+      voxelizeSphere(static_cast<const shapes::Sphere&>(shape), shape_pose, volume, occupied);
+      return true;
+    case shapes::MESH:
+      voxelizeMesh(static_cast<const shapes::Mesh&>(shape), shape_pose, volume, occupied);
+      return true;
+    case shapes::OCTREE:
+      voxelizeOcTree(static_cast<const shapes::OcTree&>(shape), shape_pose, volume, occupied);
+      return true;
+    default:
+      return false;
+  }
+}
+
+void voxelizePointCloud(const pcl::PointCloud<pcl::PointXYZ>& cloud, const Eigen::Affine3f& cloud_pose,
+                        const RoadmapVolume& volume, std::vector<rtr::Voxel>& voxels)
+{
+  const std::size_t num_voxels =
+      std::size_t(volume.voxel_resolution[0]) * volume.voxel_resolution[1] * volume.voxel_resolution[2];
+  if (num_voxels == 0)
+    return;
+
+  // transform from cloud coordinates to continuous voxel coordinates
+  Eigen::Matrix<float, 3, 4> to_voxel = cloud_pose.matrix().topRows<3>();
+  for (std::size_t axis = 0; axis < 3; ++axis)
+    to_voxel.row(axis) *= volume.voxel_resolution[axis] / volume.dimension[axis];
+
+  // deduplicate points with an occupancy grid, the extra voxel at the end collects points outside the grid
+  std::vector<uint8_t> grid(num_voxels + 1, 0);
+  binPoints(cloud.points.data(), cloud.points.size(), to_voxel, volume.voxel_resolution, grid);
+
+  // write voxels ordered by x/y/z indices
+  std::size_t index = 0;
+  for (uint16_t x = 0; x < volume.voxel_resolution[0]; ++x)
+    for (uint16_t y = 0; y < volume.voxel_resolution[1]; ++y)
+      for (uint16_t z = 0; z < volume.voxel_resolution[2]; ++z)
+        if (grid[index++])
+          voxels.push_back(rtr::Voxel(x, y, z));
+}
+}  // namespace rtr_moveit
@@ -94,6 +94,44 @@ TEST(TestSuite, testPlannerInterface)
   EXPECT_FALSE(rtr_moveit::findClosestConfigId(roadmap_states[goal_id], roadmap_states) == start_id);
 }
 
+TEST(TestSuite, testCheckSceneOnce)
+{
+  ros::NodeHandle nh;
+  rtr_moveit::RTRPlannerInterface planner(nh);
+
+  rtr_moveit::RoadmapSpecification roadmap;
+  roadmap.roadmap_id = "test_roadmap";
+  roadmap.og_file = ros::package::getPath("rtr_moveit") + "/test/test_roadmap.og";
+  rtr_moveit::OccupancyData occupancy_dummy;
+  occupancy_dummy.type = rtr_moveit::OccupancyData::Type::VOXELS;
+  const std::size_t start_id = 0;
+  const std::size_t goal_id = 10;
+  double timeout = 5000;  // milliseconds
+
+  // the scene is checked once and used for multiple path searches
+  rtr_moveit::SceneCollisions collisions;
+  ASSERT_TRUE(planner.checkScene(roadmap, occupancy_dummy, collisions)) << "Checking the scene should be successful";
+  EXPECT_EQ(collisions.roadmap.roadmap_id, roadmap.roadmap_id);
+
+  rtr_moveit::RapidPlanGoal goal;
+  goal.type = rtr_moveit::RapidPlanGoal::Type::STATE_IDS;
+  goal.state_ids = { goal_id };
+  std::deque<std::size_t> waypoints, edges;
+  ASSERT_TRUE(planner.findPath(collisions, start_id, goal, timeout, waypoints, edges));
+  EXPECT_FALSE(waypoints.empty()) << "Solution path is empty";
+
+  goal.state_ids = { start_id };
+  waypoints.clear();
+  edges.clear();
+  ASSERT_TRUE(planner.findPath(collisions, goal_id, goal, timeout, waypoints, edges));
+  EXPECT_FALSE(waypoints.empty()) << "Solution path is empty";
+
+  // collisions that don't match the roadmap edges are rejected
+  rtr_moveit::SceneCollisions invalid_collisions = collisions;
+  invalid_collisions.edge_collisions.push_back(0);
+  EXPECT_FALSE(planner.findPath(invalid_collisions, start_id, goal, timeout, waypoints, edges));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
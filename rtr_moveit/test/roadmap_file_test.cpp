@@ -0,0 +1,242 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Henning Kayser
+ * Desc: Tests for loading roadmaps from roadmap and sidecar files
+ */
+
+// C++
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// gtest
+#include <gtest/gtest.h>
+
+// ROS
+#include <ros/ros.h>
+#include <ros/package.h>
+
+// Boost
+#include <boost/filesystem.hpp>
+
+// package dependencies
+#include <rtr_moveit/roadmap_file.h>
+#include <rtr_moveit/roadmap_store.h>
+
+namespace
+{
+/** Copies the test roadmap to a temporary directory, so that sidecar files can be written next to it */
+class RoadmapFileTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    directory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory_);
+    og_file_ = (directory_ / "test_roadmap.og").string();
+    boost::filesystem::copy_file(ros::package::getPath("rtr_moveit") + "/test/test_roadmap.og", og_file_);
+    sidecar_file_ = rtr_moveit::getRoadmapSidecarFile(og_file_);
+  }
+
+  void TearDown() override
+  {
+    boost::filesystem::remove_all(directory_);
+  }
+
+  /** Generates the sidecar of the test roadmap and returns the roadmap data read from the roadmap file */
+  rtr_moveit::RoadmapData writeSidecar()
+  {
+    rtr_moveit::RoadmapData roadmap;
+    EXPECT_TRUE(rtr_moveit::loadRoadmapFile(og_file_, roadmap));
+    EXPECT_TRUE(rtr_moveit::writeRoadmapSidecar(roadmap, sidecar_file_));
+    return roadmap;
+  }
+
+  boost::filesystem::path directory_;
+  std::string og_file_;
+  std::string sidecar_file_;
+};
+}  // namespace
+
+TEST_F(RoadmapFileTest, sidecarFile)
+{
+  EXPECT_EQ(rtr_moveit::getRoadmapSidecarFile("/roadmaps/roadmap.og"), "/roadmaps/roadmap.ogmap");
+  EXPECT_EQ(rtr_moveit::getRoadmapSidecarFile("/roadmaps/roadmap"), "/roadmaps/roadmap.ogmap");
+}
+
+TEST_F(RoadmapFileTest, loadSidecar)
+{
+  rtr_moveit::RoadmapData missing;
+  EXPECT_FALSE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, missing)) << "Sidecar should be missing";
+
+  rtr_moveit::RoadmapData expected = writeSidecar();
+  rtr_moveit::RoadmapData roadmap;
+  ASSERT_TRUE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, roadmap));
+  EXPECT_EQ(roadmap.og_file, expected.og_file);
+  EXPECT_EQ(roadmap.modification_time, expected.modification_time);
+  EXPECT_EQ(*roadmap.configs, *expected.configs);
+  EXPECT_EQ(roadmap.poses, expected.poses);
+  ASSERT_EQ(roadmap.edges.size(), expected.edges.size());
+  for (std::size_t i = 0; i < roadmap.edges.size(); ++i)
+  {
+    EXPECT_EQ(roadmap.edges[i].start_index, expected.edges[i].start_index);
+    EXPECT_EQ(roadmap.edges[i].end_index, expected.edges[i].end_index);
+  }
+  EXPECT_EQ(roadmap.base_link_frame, expected.base_link_frame);
+  EXPECT_EQ(roadmap.end_effector_frame, expected.end_effector_frame);
+  EXPECT_EQ(roadmap.volume.pose.header.frame_id, expected.volume.pose.header.frame_id);
+  EXPECT_EQ(roadmap.volume.pose.pose.position.x, expected.volume.pose.pose.position.x);
+  EXPECT_EQ(roadmap.volume.pose.pose.position.y, expected.volume.pose.pose.position.y);
+  EXPECT_EQ(roadmap.volume.pose.pose.position.z, expected.volume.pose.pose.position.z);
+  EXPECT_EQ(roadmap.volume.pose.pose.orientation.x, expected.volume.pose.pose.orientation.x);
+  EXPECT_EQ(roadmap.volume.pose.pose.orientation.y, expected.volume.pose.pose.orientation.y);
+  EXPECT_EQ(roadmap.volume.pose.pose.orientation.z, expected.volume.pose.pose.orientation.z);
+  EXPECT_EQ(roadmap.volume.pose.pose.orientation.w, expected.volume.pose.pose.orientation.w);
+  EXPECT_EQ(roadmap.volume.dimension, expected.volume.dimension);
+  EXPECT_EQ(roadmap.volume.voxel_resolution, expected.volume.voxel_resolution);
+}
+
+TEST_F(RoadmapFileTest, staleSidecar)
+{
+  writeSidecar();
+
+  // a changed modification time alone is resolved by comparing the checksum of the roadmap file
+  std::time_t modification_time = boost::filesystem::last_write_time(og_file_);
+  boost::filesystem::last_write_time(og_file_, modification_time + 10);
+  rtr_moveit::RoadmapData roadmap;
+  EXPECT_TRUE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, roadmap)) << "Roadmap file content is unchanged";
+  EXPECT_EQ(roadmap.modification_time, modification_time + 10);
+
+  // a changed roadmap file invalidates the sidecar
+  {
+    std::ofstream og_stream(og_file_, std::ios::binary | std::ios::app);
+    og_stream << ' ';
+  }
+  EXPECT_FALSE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, roadmap)) << "Sidecar should be stale";
+}
+
+TEST_F(RoadmapFileTest, corruptedSidecar)
+{
+  writeSidecar();
+
+  // flip a byte at the end of the data sections
+  {
+    std::fstream sidecar_stream(sidecar_file_, std::ios::binary | std::ios::in | std::ios::out);
+    sidecar_stream.seekg(-1, std::ios::end);
+    char value = sidecar_stream.get();
+    sidecar_stream.seekp(-1, std::ios::end);
+    sidecar_stream.put(value ^ 0x5a);
+  }
+  rtr_moveit::RoadmapData roadmap;
+  EXPECT_FALSE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, roadmap)) << "Sidecar should be corrupted";
+
+  // truncated sidecar
+  boost::filesystem::resize_file(sidecar_file_, 16);
+  EXPECT_FALSE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, roadmap)) << "Sidecar should be corrupted";
+}
+
+TEST_F(RoadmapFileTest, corruptedSidecarHeader)
+{
+  writeSidecar();
+
+  // the header ends with the section offsets, the configs section starts right behind the header
+  std::fstream sidecar_stream(sidecar_file_, std::ios::binary | std::ios::in | std::ios::out);
+  std::uint64_t configs_offset_position = 0;
+  for (std::uint64_t position = 0; position < 1024; position += sizeof(std::uint64_t))
+  {
+    std::uint64_t value = 0;
+    sidecar_stream.seekg(position);
+    sidecar_stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    if (value == position + 4 * sizeof(std::uint64_t))
+    {
+      configs_offset_position = position;
+      break;
+    }
+  }
+  ASSERT_NE(configs_offset_position, 0u) << "Configs section offset not found";
+
+  // sections must not point into the header
+  const std::uint64_t header_offset = 0;
+  sidecar_stream.seekp(configs_offset_position);
+  sidecar_stream.write(reinterpret_cast<const char*>(&header_offset), sizeof(header_offset));
+  sidecar_stream.flush();
+  rtr_moveit::RoadmapData roadmap;
+  EXPECT_FALSE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, roadmap)) << "Sidecar should be corrupted";
+
+  // sections must not overlap, the poses section offset follows the configs section offset
+  const std::uint64_t configs_offset = configs_offset_position + 4 * sizeof(std::uint64_t);
+  sidecar_stream.seekp(configs_offset_position);
+  sidecar_stream.write(reinterpret_cast<const char*>(&configs_offset), sizeof(configs_offset));
+  sidecar_stream.write(reinterpret_cast<const char*>(&configs_offset), sizeof(configs_offset));
+  sidecar_stream.flush();
+  EXPECT_FALSE(rtr_moveit::loadRoadmapSidecar(sidecar_file_, og_file_, roadmap)) << "Sidecar should be corrupted";
+}
+
+TEST_F(RoadmapFileTest, roadmapStore)
+{
+  rtr_moveit::RoadmapSpecification roadmap_spec;
+  roadmap_spec.roadmap_id = "test_roadmap";
+  roadmap_spec.og_file = og_file_;
+
+  // the roadmap is only loaded once
+  rtr_moveit::RoadmapStore roadmap_store;
+  rtr_moveit::RoadmapDataConstPtr roadmap = roadmap_store.getRoadmap(roadmap_spec);
+  ASSERT_TRUE(roadmap);
+  EXPECT_EQ(roadmap, roadmap_store.getRoadmap(roadmap_spec));
+  rtr_moveit::ConfigIndexConstPtr config_index = roadmap_store.getConfigIndex(roadmap_spec.roadmap_id, roadmap);
+  EXPECT_EQ(config_index, roadmap_store.getConfigIndex(roadmap_spec.roadmap_id, roadmap));
+  EXPECT_EQ(config_index->getConfigs(), roadmap->configs);
+
+  // a changed roadmap file is reloaded from its new sidecar, the indices are rebuilt
+  writeSidecar();
+  boost::filesystem::last_write_time(og_file_, boost::filesystem::last_write_time(og_file_) + 10);
+  rtr_moveit::RoadmapDataConstPtr reloaded_roadmap = roadmap_store.getRoadmap(roadmap_spec);
+  ASSERT_TRUE(reloaded_roadmap);
+  EXPECT_NE(roadmap, reloaded_roadmap);
+  EXPECT_EQ(*roadmap->configs, *reloaded_roadmap->configs);
+  EXPECT_NE(config_index, roadmap_store.getConfigIndex(roadmap_spec.roadmap_id, reloaded_roadmap));
+
+  // missing roadmap files fail
+  roadmap_spec.og_file = (directory_ / "missing.og").string();
+  EXPECT_FALSE(roadmap_store.getRoadmap(roadmap_spec));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "roadmap_file_test");
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,426 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Author: Henning Kayser
+ * Desc: Tests for roadmap search indices
+ */
+
+// C++
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+// gtest
+#include <gtest/gtest.h>
+
+// ROS
+#include <ros/ros.h>
+
+// package dependencies
+#include <rtr_moveit/roadmap_search.h>
+
+namespace
+{
+/** Creates random configs with values in [-pi, pi], every tenth config duplicates a previous one */
+std::vector<rtr::Config> createRandomConfigs(std::size_t num_configs, std::size_t dimension, std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> distribution(-M_PI, M_PI);
+  std::vector<rtr::Config> configs(num_configs, rtr::Config(dimension));
+  for (std::size_t i = 0; i < num_configs; ++i)
+  {
+    if (i > 0 && i % 10 == 0)
+      configs[i] = configs[i / 2];
+    else
+      for (float& value : configs[i])
+        value = distribution(rng);
+  }
+  return configs;
+}
+
+/** Creates random tool poses with positions in a 1m cube, every tenth pose duplicates a previous one */
+std::vector<rtr::ToolPose> createRandomPoses(std::size_t num_poses, std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> distribution(-0.5, 0.5);
+  std::vector<rtr::ToolPose> poses(num_poses);
+  for (std::size_t i = 0; i < num_poses; ++i)
+  {
+    if (i > 0 && i % 10 == 0)
+      poses[i] = poses[i / 2];
+    else
+      for (float& value : poses[i])
+        value = distribution(rng);
+  }
+  return poses;
+}
+
+/** Brute-force search that sorts all items by distance and index */
+template <class T>
+void findClosestBruteForce(const T& item, const std::vector<T>& items, std::vector<std::size_t>& result_ids,
+                           std::vector<float>& result_distances, std::size_t max_results, float distance_threshold)
+{
+  std::vector<std::pair<float, std::size_t>> all_items;
+  for (std::size_t i = 0; i < items.size(); ++i)
+    all_items.emplace_back(rtr_moveit::getDistance<T>(item, items[i]), i);
+  std::sort(all_items.begin(), all_items.end());
+  result_ids.clear();
+  result_distances.clear();
+  for (const std::pair<float, std::size_t>& entry : all_items)
+  {
+    if (result_ids.size() == max_results || !(entry.first < distance_threshold))
+      break;
+    result_distances.push_back(entry.first);
+    result_ids.push_back(entry.second);
+  }
+}
+
+void expectEqualResults(const std::vector<std::size_t>& expected_ids, const std::vector<float>& expected_distances,
+                        const std::vector<std::size_t>& ids, const std::vector<float>& distances)
+{
+  ASSERT_EQ(expected_ids.size(), ids.size()) << "Result count differs";
+  ASSERT_EQ(expected_distances.size(), distances.size()) << "Result count differs";
+  for (std::size_t i = 0; i < ids.size(); ++i)
+  {
+    EXPECT_EQ(expected_ids[i], ids[i]);
+    EXPECT_EQ(expected_distances[i], distances[i]);
+  }
+}
+}  // namespace
+
+/* This test compares the results of the linear searches with brute-force results */
+TEST(TestSuite, compareLinearSearch)
+{
+  std::mt19937 rng(42);
+  std::vector<rtr::Config> configs = createRandomConfigs(2000, 6, rng);
+  std::vector<rtr::Config> config_queries = createRandomConfigs(20, 6, rng);
+  config_queries.insert(config_queries.end(), configs.begin(), configs.begin() + 20);  // exact matches and duplicates
+  std::vector<rtr::ToolPose> poses = createRandomPoses(2000, rng);
+  std::vector<rtr::ToolPose> pose_queries = createRandomPoses(20, rng);
+  pose_queries.insert(pose_queries.end(), poses.begin(), poses.begin() + 20);
+
+  std::vector<std::size_t> expected_ids, ids;
+  std::vector<float> expected_distances, distances;
+  for (std::size_t max_results : { 1, 2, 10, 3000 })
+  {
+    for (float distance_threshold : { 0.1f, 2.0f, FLT_MAX })
+    {
+      for (const rtr::Config& query : config_queries)
+      {
+        findClosestBruteForce(query, configs, expected_ids, expected_distances, max_results, distance_threshold);
+        rtr_moveit::findClosestConfigs(query, configs, ids, distances, max_results, distance_threshold);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+      }
+      for (const rtr::ToolPose& query : pose_queries)
+      {
+        findClosestBruteForce(query, poses, expected_ids, expected_distances, max_results, distance_threshold);
+        rtr_moveit::findClosestPositions(query, poses, ids, distances, max_results, distance_threshold);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+      }
+    }
+  }
+}
+
+/* This test compares the results of ConfigIndex queries with the results of a linear search over all configs */
+TEST(TestSuite, compareConfigIndex)
+{
+  std::mt19937 rng(42);
+  for (std::size_t dimension : { 5, 6, 7 })  // generic and fixed DOF search functions
+  {
+    std::vector<rtr::Config> configs = createRandomConfigs(5000, dimension, rng);
+    rtr_moveit::ConfigIndex config_index(configs);
+    std::vector<rtr::Config> queries = createRandomConfigs(50, dimension, rng);
+    queries.insert(queries.end(), configs.begin(), configs.begin() + 20);  // exact matches and duplicates
+
+    std::vector<std::size_t> expected_ids, ids;
+    std::vector<float> expected_distances, distances;
+    for (const rtr::Config& query : queries)
+    {
+      // k-nearest queries
+      for (std::size_t max_results : { 1, 5, 50 })
+      {
+        rtr_moveit::findClosestConfigs(query, configs, expected_ids, expected_distances, max_results);
+        config_index.findClosest(query, ids, distances, max_results);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+      }
+
+      // radius queries
+      for (float distance_threshold : { 0.5f, 4.0f, 8.0f })
+      {
+        rtr_moveit::findClosestConfigs(query, configs, expected_ids, expected_distances, distance_threshold);
+        config_index.findWithinDistance(query, ids, distances, distance_threshold);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+      }
+      EXPECT_EQ(rtr_moveit::findClosestConfigId(query, configs, 6.0), config_index.findClosestId(query, 6.0));
+    }
+  }
+}
+
+/* This test compares the results of ConfigStore queries with the results of a linear search over all configs */
+TEST(TestSuite, compareConfigStore)
+{
+  std::mt19937 rng(42);
+  for (std::size_t dimension : { 5, 6, 7 })  // generic and fixed DOF search functions
+  {
+    std::vector<rtr::Config> configs = createRandomConfigs(1001, dimension, rng);  // last block is partially filled
+    rtr_moveit::ConfigStore config_store(configs);
+    EXPECT_EQ(configs.size(), config_store.size());
+    std::vector<rtr::Config> queries = createRandomConfigs(50, dimension, rng);
+    queries.insert(queries.end(), configs.begin(), configs.begin() + 20);  // exact matches and duplicates
+
+    std::vector<std::size_t> expected_ids, ids;
+    std::vector<float> expected_distances, distances;
+    for (const rtr::Config& query : queries)
+    {
+      for (std::size_t max_results : { 1, 5, 50 })
+      {
+        rtr_moveit::findClosestConfigs(query, configs, expected_ids, expected_distances, max_results);
+        config_store.findClosest(query, ids, distances, max_results);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+      }
+      for (float distance_threshold : { 0.5f, 4.0f, 8.0f })
+      {
+        rtr_moveit::findClosestConfigs(query, configs, expected_ids, expected_distances, distance_threshold);
+        config_store.findClosest(query, ids, distances, configs.size(), distance_threshold);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+      }
+    }
+  }
+}
+
+/* This test compares weighted metric queries of ConfigStore and ConfigIndex with brute-force results */
+TEST(TestSuite, compareJointDistanceMetrics)
+{
+  std::mt19937 rng(42);
+  std::vector<rtr::Config> configs = createRandomConfigs(3000, 6, rng);
+  std::vector<rtr::Config> queries = createRandomConfigs(20, 6, rng);
+  queries.insert(queries.end(), configs.begin(), configs.begin() + 10);  // exact matches and duplicates
+  rtr_moveit::ConfigStore config_store(configs);
+  rtr_moveit::ConfigIndex config_index(configs);
+
+  rtr_moveit::JointDistanceMetric metric;
+  metric.weights = { 2.0, 2.0, 1.5, 1.0, 0.5, 0.5 };
+  for (rtr_moveit::JointDistanceMetric::Type type :
+       { rtr_moveit::JointDistanceMetric::L1, rtr_moveit::JointDistanceMetric::L2,
+         rtr_moveit::JointDistanceMetric::L_INF })
+  {
+    metric.type = type;
+    std::vector<std::size_t> expected_ids, ids;
+    std::vector<float> expected_distances, distances;
+    for (const rtr::Config& query : queries)
+    {
+      // brute-force results ordered by distance and index
+      std::vector<std::pair<float, std::size_t>> all_configs;
+      for (std::size_t i = 0; i < configs.size(); ++i)
+        all_configs.emplace_back(rtr_moveit::getJointDistance(query, configs[i], metric), i);
+      std::sort(all_configs.begin(), all_configs.end());
+
+      for (std::size_t max_results : { 1, 5, 50 })
+      {
+        for (float distance_threshold : { 1.0f, FLT_MAX })
+        {
+          expected_ids.clear();
+          expected_distances.clear();
+          for (std::size_t i = 0; i < max_results && all_configs[i].first < distance_threshold; ++i)
+          {
+            expected_distances.push_back(all_configs[i].first);
+            expected_ids.push_back(all_configs[i].second);
+          }
+          config_store.findClosest(query, ids, distances, max_results, distance_threshold, metric);
+          expectEqualResults(expected_ids, expected_distances, ids, distances);
+          config_index.findClosest(query, ids, distances, max_results, distance_threshold, metric);
+          expectEqualResults(expected_ids, expected_distances, ids, distances);
+        }
+      }
+    }
+  }
+}
+
+/* This test compares the results of quantized config stores and indices with the results of float configs */
+TEST(TestSuite, compareQuantizedConfigs)
+{
+  std::mt19937 rng(42);
+  for (std::size_t dimension : { 5, 6, 7 })
+  {
+    std::shared_ptr<std::vector<rtr::Config>> configs =
+        std::make_shared<std::vector<rtr::Config>>(createRandomConfigs(5000, dimension, rng));
+    for (std::size_t i = 0; i < 100; ++i)  // configs closer than the quantization step
+      configs->push_back(configs->at(i));
+    for (std::size_t i = 0; i < 100; ++i)
+      configs->back()[i % dimension] += 1e-6 * i;
+    std::vector<rtr::Config> queries = createRandomConfigs(20, dimension, rng);
+    queries.insert(queries.end(), configs->end() - 10, configs->end());  // exact matches and duplicates
+    queries.push_back(rtr::Config(dimension, 5.0));                     // outside of the joint ranges
+
+    rtr_moveit::ConfigStore config_store(*configs);
+    rtr_moveit::QuantizedConfigStore quantized_store(configs);
+    quantized_store.reserve(configs->size());
+    for (std::size_t i = 0; i < configs->size(); ++i)
+      quantized_store.append(i);
+    rtr_moveit::ConfigIndex quantized_index(configs, true);
+    EXPECT_TRUE(quantized_index.isQuantized());
+    EXPECT_EQ(configs, quantized_index.getConfigs());
+
+    rtr_moveit::JointDistanceMetric metric;
+    metric.weights.assign(dimension, 1.0);
+    metric.weights[0] = 2.0;
+    for (rtr_moveit::JointDistanceMetric::Type type :
+         { rtr_moveit::JointDistanceMetric::L1, rtr_moveit::JointDistanceMetric::L2,
+           rtr_moveit::JointDistanceMetric::L_INF })
+    {
+      metric.type = type;
+      std::vector<std::size_t> expected_ids, ids;
+      std::vector<float> expected_distances, distances;
+      for (const rtr::Config& query : queries)
+        for (std::size_t max_results : { 1, 5, 50 })
+          for (float distance_threshold : { 1.0f, FLT_MAX })
+          {
+            config_store.findClosest(query, expected_ids, expected_distances, max_results, distance_threshold, metric);
+            quantized_store.findClosest(query, ids, distances, max_results, distance_threshold, metric);
+            expectEqualResults(expected_ids, expected_distances, ids, distances);
+            quantized_index.findClosest(query, ids, distances, max_results, distance_threshold, metric);
+            expectEqualResults(expected_ids, expected_distances, ids, distances);
+          }
+    }
+  }
+}
+
+/* This test compares the results of batched queries with the results of single queries */
+TEST(TestSuite, compareBatchQueries)
+{
+  std::mt19937 rng(42);
+  std::vector<rtr::Config> configs = createRandomConfigs(10000, 6, rng);
+  std::vector<rtr::Config> queries = createRandomConfigs(40, 6, rng);
+  queries.insert(queries.end(), configs.begin(), configs.begin() + 10);  // exact matches and duplicates
+  queries.push_back(rtr::Config(5, 0.0));                                // invalid dimension
+  rtr_moveit::ConfigStore config_store(configs);
+  rtr_moveit::ConfigIndex config_index(configs);
+  rtr_moveit::JointDistanceMetric metric;
+
+  std::vector<std::size_t> expected_ids;
+  std::vector<float> expected_distances;
+  std::vector<std::vector<std::size_t>> ids;
+  std::vector<std::vector<float>> distances;
+  for (std::size_t num_threads : { 1, 4 })
+  {
+    for (std::size_t max_results : { 1, 20 })
+    {
+      config_store.findClosestBatch(queries, ids, distances, max_results, 3.0, metric, num_threads);
+      ASSERT_EQ(queries.size(), ids.size());
+      ASSERT_EQ(queries.size(), distances.size());
+      for (std::size_t i = 0; i < queries.size(); ++i)
+      {
+        config_store.findClosest(queries[i], expected_ids, expected_distances, max_results, 3.0, metric);
+        expectEqualResults(expected_ids, expected_distances, ids[i], distances[i]);
+      }
+
+      config_index.findClosestBatch(queries, ids, distances, max_results, 3.0, metric, num_threads);
+      ASSERT_EQ(queries.size(), ids.size());
+      ASSERT_EQ(queries.size(), distances.size());
+      for (std::size_t i = 0; i < queries.size(); ++i)
+      {
+        config_index.findClosest(queries[i], expected_ids, expected_distances, max_results, 3.0, metric);
+        expectEqualResults(expected_ids, expected_distances, ids[i], distances[i]);
+      }
+    }
+  }
+}
+
+/* This test compares the results of PoseIndex queries with the results of a linear search over all poses */
+TEST(TestSuite, comparePoseIndex)
+{
+  std::mt19937 rng(42);
+  std::vector<rtr::ToolPose> poses = createRandomPoses(5000, rng);
+  for (rtr::ToolPose& pose : poses)
+    for (std::size_t i = 3; i < 6; ++i)
+      pose[i] *= 2.0 * M_PI;  // orientations all around
+  std::vector<rtr::ToolPose> flat_poses = poses;  // all positions in a plane
+  for (rtr::ToolPose& pose : flat_poses)
+    pose[2] = 0.25;
+
+  for (const std::vector<rtr::ToolPose>& roadmap_poses : { poses, flat_poses })
+  {
+    rtr_moveit::PoseIndex pose_index(roadmap_poses);
+    std::vector<rtr::ToolPose> queries = createRandomPoses(50, rng);
+    for (std::size_t i = 0; i < 10; ++i)
+      queries[i][i % 3] *= 5.0;  // outside of the grid
+    queries.insert(queries.end(), roadmap_poses.begin(), roadmap_poses.begin() + 20);  // exact matches and duplicates
+
+    std::vector<std::size_t> expected_ids, ids;
+    std::vector<float> expected_distances, distances;
+    for (const rtr::ToolPose& query : queries)
+    {
+      // k-nearest queries
+      for (std::size_t max_results : { 1, 5, 50 })
+      {
+        rtr_moveit::findClosestPositions(query, roadmap_poses, expected_ids, expected_distances, max_results);
+        pose_index.findClosest(query, ids, distances, max_results);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+      }
+
+      // radius queries
+      for (float distance_threshold : { 0.02f, 0.1f, 0.5f })
+      {
+        rtr_moveit::findClosestPositions(query, roadmap_poses, expected_ids, expected_distances, roadmap_poses.size(),
+                                         distance_threshold);
+        pose_index.findWithinDistance(query, ids, distances, distance_threshold);
+        expectEqualResults(expected_ids, expected_distances, ids, distances);
+
+        // pose tolerance queries
+        for (float orientation_threshold : { 0.05f, 0.5f, 4.0f })
+        {
+          rtr_moveit::findClosestPositions(query, roadmap_poses, ids, distances, roadmap_poses.size(),
+                                           distance_threshold);
+          expected_ids.clear();
+          expected_distances.clear();
+          for (std::size_t i = 0; i < ids.size(); ++i)
+            if (rtr_moveit::getOrientationDistance(query, roadmap_poses[ids[i]]) < orientation_threshold)
+            {
+              expected_ids.push_back(ids[i]);
+              expected_distances.push_back(distances[i]);
+            }
+          pose_index.findWithinTolerance(query, ids, distances, distance_threshold, orientation_threshold);
+          expectEqualResults(expected_ids, expected_distances, ids, distances);
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "roadmap_search_test");
+  return RUN_ALL_TESTS();
+}
@@ -37,7 +37,9 @@
  */
 
 // C++
+#include <atomic>
 #include <limits>
+#include <thread>
 #include <vector>
 #include <string>
 
@@ -47,14 +49,23 @@
 // package dependencies
 #include <rtr_moveit/occupancy_handler.h>
 #include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/voxelization.h>
 
 // planning scene conversion
+#include <geometric_shapes/shapes.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit_msgs/CollisionObject.h>
 #include <srdfdom/model.h>
 #include <urdf_model/model.h>
 
+// OctoMap
+#include <octomap/OcTree.h>
+
+// point cloud publishing
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl_ros/point_cloud.h>
+
 // RapidPlan
 #include <rtr-occupancy/Voxel.hpp>
 
@@ -149,6 +160,424 @@ TEST(TestSuite, convertPlanningScene)
                                                                                           "though there should be 125";
 }
 
+/* Creates an empty planning scene and a volume region of 1m^3 with 10^3 voxels in the planning frame */
+void createEmptyScene(planning_scene::PlanningScenePtr& scene, rtr_moveit::RoadmapVolume& volume)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model(new urdf::ModelInterface());
+  srdf::ModelConstSharedPtr srdf_model(new srdf::Model());
+  moveit::core::RobotModelConstPtr robot_model(new moveit::core::RobotModel(urdf_model, srdf_model));
+  scene.reset(new planning_scene::PlanningScene(robot_model));
+
+  volume = rtr_moveit::RoadmapVolume();
+  volume.pose.header.frame_id = scene->getPlanningFrame();
+  volume.pose.pose.orientation.w = 1.0;
+  volume.dimension = { { 1.0, 1.0, 1.0 } };
+  volume.voxel_resolution = { { 10, 10, 10 } };
+}
+
+// Expect that both voxel vectors contain the same voxels in the same order
+void expectEqualVoxels(const std::vector<rtr::Voxel>& expected_voxels, const std::vector<rtr::Voxel>& voxels)
+{
+  ASSERT_EQ(expected_voxels.size(), voxels.size()) << "Voxel count differs";
+  for (std::size_t i = 0; i < voxels.size(); ++i)
+  {
+    EXPECT_EQ(expected_voxels[i].x, voxels[i].x);
+    EXPECT_EQ(expected_voxels[i].y, voxels[i].y);
+    EXPECT_EQ(expected_voxels[i].z, voxels[i].z);
+  }
+}
+
+/* Expect that all voxelization methods generate the same voxels as single-threaded collision checks */
+void expectEqualVoxelizationMethods(const planning_scene::PlanningSceneConstPtr& scene,
+                                    rtr_moveit::OccupancyHandler& occupancy_handler)
+{
+  rtr_moveit::OccupancyData expected_occupancy, occupancy;
+  occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::COLLISION_CHECKS);
+  occupancy_handler.setVoxelizationThreads(1);
+  occupancy_handler.fromPlanningScene(scene, expected_occupancy);
+  EXPECT_FALSE(expected_occupancy.voxels.empty()) << "No occupancy voxels created";
+
+  // analytic voxelization
+  occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::ANALYTIC);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  expectEqualVoxels(expected_occupancy.voxels, occupancy.voxels);
+
+  // hierarchical collision checks
+  occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::HIERARCHICAL);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  expectEqualVoxels(expected_occupancy.voxels, occupancy.voxels);
+
+  // multi-threaded collision checks
+  occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::COLLISION_CHECKS);
+  occupancy_handler.setVoxelizationThreads(4);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  expectEqualVoxels(expected_occupancy.voxels, occupancy.voxels);
+}
+
+/* This test compares the voxels generated by the different voxelization methods with the voxels generated by
+ * checking each voxel for collisions in a single thread. The scene contains all shape types including an OcTree and
+ * is checked with shifted and rotated volume regions. */
+TEST(TestSuite, compareVoxelizationMethods)
+{
+  ros::NodeHandle nh;
+  planning_scene::PlanningScenePtr scene;
+  rtr_moveit::RoadmapVolume volume;
+  createEmptyScene(scene, volume);
+
+  // create collision object with an axis-aligned and a rotated box
+  moveit_msgs::CollisionObject obj;
+  obj.id = "collision_object";
+  obj.header.frame_id = scene->getPlanningFrame();
+  obj.primitives.resize(2);
+  obj.primitive_poses.resize(2);
+  for (std::size_t i = 0; i < obj.primitives.size(); ++i)
+  {
+    obj.primitives[i].type = shape_msgs::SolidPrimitive::BOX;
+    obj.primitives[i].dimensions.resize(3);
+    obj.primitives[i].dimensions[shape_msgs::SolidPrimitive::BOX_X] = 0.33;
+    obj.primitives[i].dimensions[shape_msgs::SolidPrimitive::BOX_Y] = 0.27;
+    obj.primitives[i].dimensions[shape_msgs::SolidPrimitive::BOX_Z] = 0.41;
+  }
+  obj.primitive_poses[0].orientation.w = 1.0;
+  obj.primitive_poses[0].position.x = 0.253;
+  obj.primitive_poses[0].position.y = 0.312;
+  obj.primitive_poses[0].position.z = 0.207;
+  // rotated by 30 degrees around the z-axis
+  obj.primitive_poses[1].orientation.z = 0.258819;
+  obj.primitive_poses[1].orientation.w = 0.965926;
+  obj.primitive_poses[1].position.x = 0.684;
+  obj.primitive_poses[1].position.y = 0.627;
+  obj.primitive_poses[1].position.z = 0.553;
+  obj.operation = moveit_msgs::CollisionObject::ADD;
+  scene->processCollisionObjectMsg(obj);
+
+  // add sphere, cylinder and cone objects, cylinders and cones are voxelized with collision checks of their bounds
+  moveit_msgs::CollisionObject primitive_obj;
+  primitive_obj.header.frame_id = scene->getPlanningFrame();
+  primitive_obj.primitives.resize(1);
+  primitive_obj.primitive_poses.resize(1);
+  primitive_obj.operation = moveit_msgs::CollisionObject::ADD;
+  primitive_obj.id = "sphere";
+  primitive_obj.primitives[0].type = shape_msgs::SolidPrimitive::SPHERE;
+  primitive_obj.primitives[0].dimensions = { 0.173 };
+  primitive_obj.primitive_poses[0].orientation.w = 1.0;
+  primitive_obj.primitive_poses[0].position.x = 0.287;
+  primitive_obj.primitive_poses[0].position.y = 0.761;
+  primitive_obj.primitive_poses[0].position.z = 0.318;
+  scene->processCollisionObjectMsg(primitive_obj);
+  primitive_obj.id = "cylinder";
+  primitive_obj.primitives[0].type = shape_msgs::SolidPrimitive::CYLINDER;
+  primitive_obj.primitives[0].dimensions = { 0.312, 0.093 };  // height, radius
+  primitive_obj.primitive_poses[0].orientation.x = 0.382683;  // rotated by 45 degrees around the x-axis
+  primitive_obj.primitive_poses[0].orientation.w = 0.923880;
+  primitive_obj.primitive_poses[0].position.x = 0.741;
+  primitive_obj.primitive_poses[0].position.y = 0.236;
+  primitive_obj.primitive_poses[0].position.z = 0.274;
+  scene->processCollisionObjectMsg(primitive_obj);
+  primitive_obj.id = "cone";
+  primitive_obj.primitives[0].type = shape_msgs::SolidPrimitive::CONE;
+  primitive_obj.primitives[0].dimensions = { 0.257, 0.121 };  // height, radius
+  primitive_obj.primitive_poses[0].orientation.x = 0.0;
+  primitive_obj.primitive_poses[0].orientation.w = 1.0;
+  primitive_obj.primitive_poses[0].position.x = 0.523;
+  primitive_obj.primitive_poses[0].position.y = 0.489;
+  primitive_obj.primitive_poses[0].position.z = 0.812;
+  scene->processCollisionObjectMsg(primitive_obj);
+
+  // add a tetrahedron mesh, meshes only collide with voxels that intersect their triangles
+  moveit_msgs::CollisionObject mesh_obj;
+  mesh_obj.id = "mesh";
+  mesh_obj.header.frame_id = scene->getPlanningFrame();
+  mesh_obj.meshes.resize(1);
+  mesh_obj.mesh_poses.resize(1);
+  mesh_obj.mesh_poses[0].orientation.w = 1.0;
+  mesh_obj.mesh_poses[0].position.x = 0.117;
+  mesh_obj.mesh_poses[0].position.y = 0.083;
+  mesh_obj.mesh_poses[0].position.z = 0.611;
+  mesh_obj.meshes[0].vertices.resize(4);
+  mesh_obj.meshes[0].vertices[1].x = 0.347;
+  mesh_obj.meshes[0].vertices[2].y = 0.291;
+  mesh_obj.meshes[0].vertices[3].x = 0.103;
+  mesh_obj.meshes[0].vertices[3].y = 0.098;
+  mesh_obj.meshes[0].vertices[3].z = 0.263;
+  mesh_obj.meshes[0].triangles.resize(4);
+  mesh_obj.meshes[0].triangles[0].vertex_indices = { { 0, 1, 2 } };
+  mesh_obj.meshes[0].triangles[1].vertex_indices = { { 0, 1, 3 } };
+  mesh_obj.meshes[0].triangles[2].vertex_indices = { { 0, 2, 3 } };
+  mesh_obj.meshes[0].triangles[3].vertex_indices = { { 1, 2, 3 } };
+  mesh_obj.operation = moveit_msgs::CollisionObject::ADD;
+  scene->processCollisionObjectMsg(mesh_obj);
+
+  // add an OcTree with single occupied leaves, a pruned block of occupied leaves, free leaves and an occupied leaf
+  // outside of the volume region
+  std::shared_ptr<octomap::OcTree> octree = std::make_shared<octomap::OcTree>(0.05);
+  octree->updateNode(octomap::point3d(0.025, 0.025, 0.025), true);
+  octree->updateNode(octomap::point3d(0.125, 0.275, 0.075), true);
+  for (float x : { 0.225f, 0.275f })
+    for (float y : { 0.225f, 0.275f })
+      for (float z : { 0.225f, 0.275f })
+        octree->updateNode(octomap::point3d(x, y, z), true);
+  octree->updateNode(octomap::point3d(0.375, 0.025, 0.025), false);
+  octree->updateNode(octomap::point3d(0.075, 0.175, 0.125), false);
+  octree->updateNode(octomap::point3d(3.025, 3.025, 3.025), true);
+  ASSERT_LT(octree->getNumLeafNodes(), 13u) << "Occupied block should have been pruned";
+  rtr_moveit::OccupancyHandler::WorldTransform octree_pose = rtr_moveit::OccupancyHandler::WorldTransform::Identity();
+  octree_pose.translate(Eigen::Vector3d(0.412, 0.058, 0.137));
+  octree_pose.rotate(Eigen::AngleAxisd(0.2, Eigen::Vector3d::UnitZ()));
+  scene->getWorldNonConst()->addToObject("octree", std::make_shared<const shapes::OcTree>(octree), octree_pose);
+
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+  const Eigen::Quaterniond volume_rotation(Eigen::AngleAxisd(0.3, Eigen::Vector3d(1.0, 2.0, 3.0).normalized()));
+  for (const Eigen::Quaterniond& volume_orientation : { Eigen::Quaterniond::Identity(), volume_rotation })
+  {
+    volume.pose.pose.orientation.x = volume_orientation.x();
+    volume.pose.pose.orientation.y = volume_orientation.y();
+    volume.pose.pose.orientation.z = volume_orientation.z();
+    volume.pose.pose.orientation.w = volume_orientation.w();
+    for (double volume_offset : { 0.0, 0.1234, 0.501 })
+    {
+      volume.pose.pose.position.x = volume_offset;
+      volume.pose.pose.position.y = -0.5 * volume_offset;
+      occupancy_handler.setVolumeRegion(volume);
+      SCOPED_TRACE("volume offset " + std::to_string(volume_offset) + ", rotated volume " +
+                   std::to_string(!volume_orientation.isApprox(Eigen::Quaterniond::Identity())));
+      expectEqualVoxelizationMethods(scene, occupancy_handler);
+    }
+  }
+}
+
+/* This test modifies the collision objects of a planning scene and checks that ANALYTIC voxelization updates the
+ * voxels of the modified objects correctly. */
+TEST(TestSuite, updateVoxelsIncrementally)
+{
+  ros::NodeHandle nh;
+  planning_scene::PlanningScenePtr scene;
+  rtr_moveit::RoadmapVolume volume;
+  createEmptyScene(scene, volume);
+
+  // add two box objects that overlap in 8 voxels
+  moveit_msgs::CollisionObject obj;
+  obj.header.frame_id = scene->getPlanningFrame();
+  obj.primitives.resize(1);
+  obj.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+  obj.primitives[0].dimensions.resize(3, 0.39);
+  obj.primitive_poses.resize(1);
+  obj.primitive_poses[0].orientation.w = 1.0;
+  obj.primitive_poses[0].position.x = 0.3;
+  obj.primitive_poses[0].position.y = 0.3;
+  obj.primitive_poses[0].position.z = 0.3;
+  obj.operation = moveit_msgs::CollisionObject::ADD;
+  obj.id = "box_1";
+  scene->processCollisionObjectMsg(obj);
+  obj.primitive_poses[0].position.x = 0.5;
+  obj.primitive_poses[0].position.y = 0.5;
+  obj.primitive_poses[0].position.z = 0.5;
+  obj.id = "box_2";
+  scene->processCollisionObjectMsg(obj);
+
+  // voxelize scene
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+  occupancy_handler.setVolumeRegion(volume);
+  occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::ANALYTIC);
+  rtr_moveit::OccupancyData occupancy;
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  EXPECT_EQ(occupancy.voxels.size(), 120u);
+
+  // unchanged scene
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  EXPECT_EQ(occupancy.voxels.size(), 120u);
+
+  // move second box out of the volume region
+  obj.id = "box_2";
+  obj.primitive_poses[0].position.x = 2.0;
+  obj.operation = moveit_msgs::CollisionObject::MOVE;
+  scene->processCollisionObjectMsg(obj);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  EXPECT_EQ(occupancy.voxels.size(), 64u);
+
+  // remove first box
+  obj.id = "box_1";
+  obj.operation = moveit_msgs::CollisionObject::REMOVE;
+  scene->processCollisionObjectMsg(obj);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  EXPECT_TRUE(occupancy.voxels.empty()) << "Created " << occupancy.voxels.size() << " occupancy voxels even though "
+                                                                                    "there should be none";
+}
+
+/* This test queries the voxels of a planning scene repeatedly and checks that unchanged scenes reuse cached results. */
+TEST(TestSuite, cacheOccupancyResults)
+{
+  ros::NodeHandle nh;
+  planning_scene::PlanningScenePtr scene;
+  rtr_moveit::RoadmapVolume volume;
+  createEmptyScene(scene, volume);
+
+  // add box object
+  moveit_msgs::CollisionObject obj;
+  obj.header.frame_id = scene->getPlanningFrame();
+  obj.primitives.resize(1);
+  obj.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+  obj.primitives[0].dimensions.resize(3, 0.39);
+  obj.primitive_poses.resize(1);
+  obj.primitive_poses[0].orientation.w = 1.0;
+  obj.primitive_poses[0].position.x = 0.3;
+  obj.primitive_poses[0].position.y = 0.3;
+  obj.primitive_poses[0].position.z = 0.3;
+  obj.operation = moveit_msgs::CollisionObject::ADD;
+  obj.id = "box";
+  scene->processCollisionObjectMsg(obj);
+
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+  occupancy_handler.setVolumeRegion(volume);
+  occupancy_handler.setOccupancyCacheSize(2);
+  rtr_moveit::OccupancyData occupancy;
+  rtr_moveit::OccupancyData expected_occupancy;
+  occupancy_handler.fromPlanningScene(scene, expected_occupancy);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  EXPECT_EQ(occupancy_handler.getCacheMisses(), 1u);
+  EXPECT_EQ(occupancy_handler.getCacheHits(), 1u);
+  expectEqualVoxels(expected_occupancy.voxels, occupancy.voxels);
+
+  // moving the box invalidates the result
+  obj.primitive_poses[0].position.x = 0.5;
+  obj.operation = moveit_msgs::CollisionObject::MOVE;
+  scene->processCollisionObjectMsg(obj);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  EXPECT_EQ(occupancy_handler.getCacheMisses(), 2u);
+  EXPECT_EQ(occupancy.voxels.size(), 64u);
+
+  // moving the box back reuses the first result
+  obj.primitive_poses[0].position.x = 0.3;
+  scene->processCollisionObjectMsg(obj);
+  occupancy_handler.fromPlanningScene(scene, occupancy);
+  EXPECT_EQ(occupancy_handler.getCacheHits(), 2u);
+  expectEqualVoxels(expected_occupancy.voxels, occupancy.voxels);
+}
+
+/* This test checks voxel list conversions and set operations of occupancy grids. */
+TEST(TestSuite, occupancyGridOperations)
+{
+  std::array<uint16_t, 3> resolution = { { 5, 6, 7 } };
+  rtr_moveit::OccupancyGrid grid_a(resolution);
+  rtr_moveit::OccupancyGrid grid_b(resolution);
+  std::vector<rtr::Voxel> voxels_a = { rtr::Voxel(0, 0, 0), rtr::Voxel(0, 5, 6), rtr::Voxel(2, 3, 4),
+                                       rtr::Voxel(4, 5, 6) };
+  std::vector<rtr::Voxel> voxels_b = { rtr::Voxel(0, 5, 6), rtr::Voxel(3, 0, 1), rtr::Voxel(4, 5, 6) };
+  grid_a.fromVoxels(voxels_a);
+  grid_b.fromVoxels(voxels_b);
+  EXPECT_EQ(grid_a.size(), 210u);
+  EXPECT_EQ(grid_a.count(), 4u);
+  EXPECT_TRUE(grid_a.test(2, 3, 4));
+  EXPECT_FALSE(grid_a.test(3, 0, 1));
+
+  // voxel lists are ordered by x/y/z indices
+  std::vector<rtr::Voxel> voxels;
+  grid_a.toVoxels(voxels);
+  expectEqualVoxels(voxels_a, voxels);
+
+  rtr_moveit::OccupancyGrid grid_union(grid_a);
+  grid_union |= grid_b;
+  EXPECT_EQ(grid_union.count(), 5u);
+  rtr_moveit::OccupancyGrid grid_intersection(grid_a);
+  grid_intersection &= grid_b;
+  voxels.clear();
+  grid_intersection.toVoxels(voxels);
+  expectEqualVoxels({ rtr::Voxel(0, 5, 6), rtr::Voxel(4, 5, 6) }, voxels);
+  rtr_moveit::OccupancyGrid grid_difference(grid_a);
+  grid_difference -= grid_b;
+  voxels.clear();
+  grid_difference.toVoxels(voxels);
+  expectEqualVoxels({ rtr::Voxel(0, 0, 0), rtr::Voxel(2, 3, 4) }, voxels);
+  grid_difference |= grid_intersection;
+  EXPECT_TRUE(grid_difference == grid_a);
+
+  grid_a.clear();
+  EXPECT_FALSE(grid_a.any());
+}
+
+/* This test converts a small point cloud with duplicate, outside and invalid points into voxels. */
+TEST(TestSuite, voxelizePointCloud)
+{
+  rtr_moveit::RoadmapVolume volume;
+  volume.dimension = { { 1.0, 1.0, 1.0 } };
+  volume.voxel_resolution = { { 10, 10, 10 } };
+
+  // more than 8 points so that vectorized and scalar implementations are used
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  cloud.push_back(pcl::PointXYZ(0.95, 0.05, 0.05));
+  cloud.push_back(pcl::PointXYZ(0.15, 0.25, 0.35));
+  cloud.push_back(pcl::PointXYZ(1.5, 0.5, 0.5));
+  cloud.push_back(pcl::PointXYZ(-0.01, 0.5, 0.5));
+  cloud.push_back(pcl::PointXYZ(std::numeric_limits<float>::quiet_NaN(), 0.5, 0.5));
+  for (std::size_t i = 0; i < 5; ++i)
+    cloud.push_back(pcl::PointXYZ(0.15, 0.25, 0.35));
+
+  std::vector<rtr::Voxel> voxels;
+  rtr_moveit::voxelizePointCloud(cloud, Eigen::Affine3f::Identity(), volume, voxels);
+  std::vector<rtr::Voxel> expected_voxels = { rtr::Voxel(1, 2, 3), rtr::Voxel(9, 0, 0) };
+  expectEqualVoxels(expected_voxels, voxels);
+
+  // shifted cloud pose moves the first point out of and the fourth point into the volume
+  voxels.clear();
+  rtr_moveit::voxelizePointCloud(cloud, Eigen::Affine3f(Eigen::Translation3f(0.1, 0.0, 0.0)), volume, voxels);
+  expected_voxels = { rtr::Voxel(0, 5, 5), rtr::Voxel(2, 2, 3) };
+  expectEqualVoxels(expected_voxels, voxels);
+}
+
+/* This test publishes point clouds at 10Hz and checks that point cloud queries use the latest message of the
+ * persistent subscriber instead of waiting for the next one. */
+TEST(TestSuite, pointCloudLatency)
+{
+  ros::NodeHandle nh;
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  // point clouds are published in the volume frame so that no transform is required
+  rtr_moveit::RoadmapVolume volume;
+  volume.pose.header.frame_id = "volume_frame";
+  volume.pose.pose.orientation.w = 1.0;
+  const std::string pcl_topic = "test_point_cloud";
+  ros::Publisher pcl_pub = nh.advertise<pcl::PointCloud<pcl::PointXYZ>>(pcl_topic, 1);
+  std::atomic<bool> publishing(true);
+  std::thread publisher([&]() {
+    pcl::PointCloud<pcl::PointXYZ> cloud;
+    cloud.header.frame_id = volume.pose.header.frame_id;
+    cloud.push_back(pcl::PointXYZ(0.1, 0.2, 0.3));
+    ros::Rate rate(10);
+    while (publishing && ros::ok())
+    {
+      pcl_conversions::toPCL(ros::Time::now(), cloud.header.stamp);
+      pcl_pub.publish(cloud);
+      rate.sleep();
+    }
+  });
+
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+  occupancy_handler.setVolumeRegion(volume);
+  occupancy_handler.setPointCloudTopic(pcl_topic);
+  occupancy_handler.setPointCloudMaxAge(0.5);
+
+  // the first query waits until the subscriber has received a message
+  rtr_moveit::OccupancyData occupancy;
+  ASSERT_TRUE(occupancy_handler.fromPointCloud(pcl_topic, occupancy, 5000));
+  ASSERT_TRUE(occupancy.point_cloud);
+  EXPECT_EQ(occupancy.point_cloud->size(), 1u);
+
+  // following queries should return much faster than the publishing period
+  const std::size_t num_queries = 20;
+  ros::WallTime start = ros::WallTime::now();
+  for (std::size_t i = 0; i < num_queries; ++i)
+    EXPECT_TRUE(occupancy_handler.fromPointCloud(pcl_topic, occupancy));
+  double latency = (ros::WallTime::now() - start).toSec() / num_queries;
+  EXPECT_LT(latency, 0.01) << "Point cloud queries took " << latency << "s on average";
+
+  // point clouds exceeding the max age are rejected
+  publishing = false;
+  publisher.join();
+  occupancy_handler.setPointCloudMaxAge(0.0);
+  EXPECT_FALSE(occupancy_handler.fromPointCloud(pcl_topic, occupancy, 200));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);